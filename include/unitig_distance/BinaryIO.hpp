@@ -0,0 +1,147 @@
+/*
+    Helpers for the binary index and graph cache files written next to the input graph.
+    Values are written in native byte order; files are only meant to be reused on the same machine.
+*/
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "types.hpp"
+
+class BinaryIO {
+public:
+    template <typename T>
+    static void write_value(std::ofstream& ofs, const T& value) { ofs.write(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+    template <typename T>
+    static void write_vector(std::ofstream& ofs, const std::vector<T>& vector) {
+        uint64_t sz = vector.size();
+        write_value(ofs, sz);
+        ofs.write(reinterpret_cast<const char*>(vector.data()), sz * sizeof(T));
+    }
+
+    template <typename T>
+    static bool read_value(std::ifstream& ifs, T& value) { return (bool) ifs.read(reinterpret_cast<char*>(&value), sizeof(T)); }
+
+    template <typename T>
+    static bool read_vector(std::ifstream& ifs, std::vector<T>& vector) {
+        uint64_t sz;
+        if (!read_value(ifs, sz)) return false;
+        vector.resize(sz);
+        return (bool) ifs.read(reinterpret_cast<char*>(vector.data()), sz * sizeof(T));
+    }
+
+    /*
+        Write a header consisting of a four character magic string, format version, the widths of node_t and weight_t
+        and a fingerprint of the data the file was built from. The widths differ between the normal and the compact
+        build, which can't read each other's files.
+    */
+    static void write_header(std::ofstream& ofs, const std::string& magic, uint32_t version, uint64_t fingerprint) {
+        ofs.write(magic.data(), 4);
+        write_value(ofs, version);
+        write_value(ofs, type_widths());
+        write_value(ofs, fingerprint);
+    }
+
+    static bool read_header(std::ifstream& ifs, const std::string& magic, uint32_t version, uint64_t fingerprint) {
+        std::string file_magic(4, '\0');
+        uint32_t file_version, file_type_widths;
+        uint64_t file_fingerprint;
+        if (!ifs.read(&file_magic[0], 4) || !read_value(ifs, file_version) || !read_value(ifs, file_type_widths) || !read_value(ifs, file_fingerprint)) return false;
+        return file_magic == magic && file_version == version && file_type_widths == type_widths() && file_fingerprint == fingerprint;
+    }
+
+    static uint32_t type_widths() { return sizeof(node_t) << 8 | sizeof(weight_t); }
+
+    // 64-bit FNV-1a hash, can be chained over several arrays by passing the previous hash.
+    template <typename T>
+    static uint64_t hash(const std::vector<T>& vector, uint64_t hash = 14695981039346656037ULL) {
+        return hash_bytes(reinterpret_cast<const unsigned char*>(vector.data()), vector.size() * sizeof(T), hash);
+    }
+
+    // Hash of a file's size and modification time, which change whenever the file is rewritten. Cheaper than a checksum of the contents of large input files.
+    static uint64_t file_fingerprint(const std::string& filename, uint64_t hash = 14695981039346656037ULL) {
+        struct stat st;
+        if (stat(filename.c_str(), &st) != 0) return hash;
+        int64_t size = st.st_size, mtime = st.st_mtime;
+        hash = hash_bytes(reinterpret_cast<const unsigned char*>(&size), sizeof(size), hash);
+        return hash_bytes(reinterpret_cast<const unsigned char*>(&mtime), sizeof(mtime), hash);
+    }
+
+    static uint64_t hash_bytes(const unsigned char* data, std::size_t sz, uint64_t hash = 14695981039346656037ULL) {
+        for (std::size_t i = 0; i < sz; ++i) {
+            hash ^= data[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+};
+
+// Read-only memory mapping of a file. Binary files are read sequentially in the same format as BinaryIO writes.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filename) : m_data(nullptr), m_size(0), m_pos(0) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                m_data = static_cast<const char*>(data);
+                m_size = st.st_size;
+                madvise(data, m_size, MADV_SEQUENTIAL);
+            }
+        }
+        close(fd);
+    }
+    ~MappedFile() { if (m_data) munmap(const_cast<char*>(m_data), m_size); }
+    MappedFile(const MappedFile& other) = delete;
+    MappedFile& operator=(const MappedFile& other) = delete;
+
+    bool good() const { return m_data != nullptr; }
+
+    const char* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+
+    template <typename T>
+    bool read_value(T& value) { return read_bytes(reinterpret_cast<char*>(&value), sizeof(T)); }
+
+    template <typename T>
+    bool read_vector(std::vector<T>& vector) {
+        uint64_t sz;
+        if (!read_value(sz) || sz > (m_size - m_pos) / sizeof(T)) return false;
+        vector.resize(sz);
+        return read_bytes(reinterpret_cast<char*>(vector.data()), sz * sizeof(T));
+    }
+
+    bool read_header(const std::string& magic, uint32_t version, uint64_t fingerprint) {
+        std::string file_magic(4, '\0');
+        uint32_t file_version, file_type_widths;
+        uint64_t file_fingerprint;
+        if (!read_bytes(&file_magic[0], 4) || !read_value(file_version) || !read_value(file_type_widths) || !read_value(file_fingerprint)) return false;
+        return file_magic == magic && file_version == version && file_type_widths == BinaryIO::type_widths() && file_fingerprint == fingerprint;
+    }
+
+private:
+    const char* m_data;
+    std::size_t m_size;
+    std::size_t m_pos;
+
+    bool read_bytes(char* out, std::size_t n) {
+        if (!good() || n > m_size - m_pos) return false;
+        std::memcpy(out, m_data + m_pos, n);
+        m_pos += n;
+        return true;
+    }
+
+};
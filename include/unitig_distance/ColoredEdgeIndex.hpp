@@ -0,0 +1,344 @@
+/*
+    Colored edge index of the single genome graphs. Every single genome graph is an edge-induced subgraph
+    of the compacted de Bruijn graph, so instead of parsing each genome's edges file into a new graph for
+    every run, the files are read once and each edge of the compacted de Bruijn graph stores the set of
+    genomes (colors) it appears in. Color sets are run-length encoded as sorted ranges of genome indices,
+    which stays small when similar genomes are listed next to each other. The index is saved next to the
+    single genome graph paths file for reuse in later runs. A single genome graph is then read through a
+    ColoredSubgraph, which is a view of the compacted de Bruijn graph filtered by the genome's color.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "BinaryIO.hpp"
+#include "CsrGraph.hpp"
+#include "GraphBuilder.hpp"
+#include "ThreadPool.hpp"
+#include "Utils.hpp"
+#include "types.hpp"
+
+class ColoredEdgeIndex {
+public:
+    // Genomes [begin, end) that contain an edge.
+    struct ColorRun {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    ColoredEdgeIndex() : m_n_cdbg_edges(0), m_extra_offsets(), m_extra_targets(), m_run_offsets(1, 0), m_runs(), m_n_nodes() { }
+
+    // Number of genomes, zero if the index couldn't be built.
+    std::size_t n_colors() const { return m_n_nodes.size(); }
+
+    std::size_t n_runs() const { return m_runs.size(); }
+
+    std::size_t n_extra_edges() const { return m_extra_targets.size(); }
+
+    // Number of nodes spanned by a genome's edges.
+    int_t n_nodes(int_t color) const { return m_n_nodes[color]; }
+
+    /*
+        Edges of the genomes that are not in the compacted de Bruijn graph, for example because the
+        overlap was missing from the main graph's edges file, are indexed after the edges of the
+        compacted de Bruijn graph.
+    */
+    int_t extra_edge_index_begin(int_t v) const { return m_n_cdbg_edges + m_extra_offsets[v]; }
+    int_t extra_edge_index_end(int_t v) const { return m_n_cdbg_edges + m_extra_offsets[v + 1]; }
+    int_t extra_edge_target(int_t edge_idx) const { return m_extra_targets[edge_idx - m_n_cdbg_edges]; }
+
+    // Check if the edge with edge_idx is in the genome with color.
+    bool has_color(int_t edge_idx, int_t color) const {
+        auto first = m_runs.begin() + m_run_offsets[edge_idx];
+        auto last = m_runs.begin() + m_run_offsets[edge_idx + 1];
+        auto it = std::upper_bound(first, last, color, [](int_t c, const ColorRun& run) { return c < (int_t) run.begin; });
+        return it != first && color < (int_t) (it - 1)->end;
+    }
+
+    static ColoredEdgeIndex load_or_build(const CsrGraph& cdbg, const std::vector<std::string>& edges_filenames, const std::string& filename, int_t n_threads) {
+        ColoredEdgeIndex index;
+        auto fingerprint = input_fingerprint(cdbg, edges_filenames);
+        if (index.load(cdbg, filename, fingerprint) && index.n_colors() == edges_filenames.size()) return index;
+        index = build(cdbg, edges_filenames, n_threads);
+        if (index.n_colors() > 0 && !index.save(filename, fingerprint)) std::cerr << "Warning: Couldn't save colored edge index to " << filename << std::endl;
+        return index;
+    }
+
+    /*
+        The edges files are read in parallel in batches of genomes, so that only a batch of edge lists is
+        kept in memory. Each batch is then added to the color runs in parallel over ranges of edges. Genomes
+        are added in order, so a genome either extends the last run of an edge or starts a new one. Edges
+        that are not in the compacted de Bruijn graph are collected with their colors and indexed at the end.
+    */
+    static ColoredEdgeIndex build(const CsrGraph& cdbg, const std::vector<std::string>& edges_filenames, int_t n_threads) {
+        std::size_t n_cdbg_edges = cdbg.n_edge_indices(), n_genomes = edges_filenames.size();
+        std::size_t stride = std::max<int_t>(n_threads, 1), batch_size = BATCH_SIZE_PER_THREAD * stride;
+        std::vector<std::vector<ColorRun>> edge_runs(n_cdbg_edges);
+        std::vector<std::tuple<int_t, int_t, uint32_t>> extra_edges;
+        std::vector<int_t> n_nodes(n_genomes);
+
+        for (std::size_t batch_begin = 0; batch_begin < n_genomes; batch_begin += batch_size) {
+            std::size_t batch_end = std::min(batch_begin + batch_size, n_genomes);
+            std::vector<std::vector<int_t>> batch_edges(batch_end - batch_begin);
+            std::vector<std::vector<std::pair<int_t, int_t>>> batch_extra_edges(batch_edges.size());
+            std::vector<char> ok(batch_edges.size());
+            ThreadPool::instance().run(batch_edges.size(), [&cdbg, &edges_filenames, &batch_edges, &batch_extra_edges, &n_nodes, &ok, batch_begin](std::size_t i) {
+                std::vector<std::pair<int_t, int_t>> edges;
+                ok[i] = GraphBuilder::read_cdbg_subgraph_edges(cdbg, edges_filenames[batch_begin + i], edges, n_nodes[batch_begin + i]);
+                for (const auto& edge : edges) {
+                    int_t edge_idx = cdbg.edge_index(edge.first, edge.second);
+                    if (edge_idx == -1) {
+                        batch_extra_edges[i].push_back(edge);
+                        batch_extra_edges[i].emplace_back(edge.second, edge.first);
+                        continue;
+                    }
+                    batch_edges[i].push_back(edge_idx);
+                    batch_edges[i].push_back(cdbg.edge_index(edge.second, edge.first));
+                }
+                std::sort(batch_edges[i].begin(), batch_edges[i].end());
+                batch_edges[i].erase(std::unique(batch_edges[i].begin(), batch_edges[i].end()), batch_edges[i].end());
+            });
+            if (std::find(ok.begin(), ok.end(), false) != ok.end()) return ColoredEdgeIndex();
+
+            ThreadPool::instance().run(stride, [&batch_edges, &edge_runs, n_cdbg_edges, stride, batch_begin](std::size_t thr) {
+                int_t range_begin = n_cdbg_edges * thr / stride, range_end = n_cdbg_edges * (thr + 1) / stride;
+                for (std::size_t i = 0; i < batch_edges.size(); ++i) {
+                    const auto& edges = batch_edges[i];
+                    for (auto it = std::lower_bound(edges.begin(), edges.end(), range_begin); it != edges.end() && *it < range_end; ++it) {
+                        add_color(edge_runs[*it], batch_begin + i);
+                    }
+                }
+            });
+            for (std::size_t i = 0; i < batch_extra_edges.size(); ++i) {
+                for (const auto& edge : batch_extra_edges[i]) extra_edges.emplace_back(edge.first, edge.second, batch_begin + i);
+            }
+        }
+
+        ColoredEdgeIndex index;
+        index.m_n_cdbg_edges = n_cdbg_edges;
+        index.m_n_nodes = std::move(n_nodes);
+
+        // Extra edges in CSR format, sorted by source node and target node.
+        std::sort(extra_edges.begin(), extra_edges.end());
+        extra_edges.erase(std::unique(extra_edges.begin(), extra_edges.end()), extra_edges.end());
+        index.m_extra_offsets.resize(cdbg.size() + 1);
+        for (std::size_t i = 0; i < extra_edges.size(); ++i) {
+            int_t v, w;
+            uint32_t color;
+            std::tie(v, w, color) = extra_edges[i];
+            if (i == 0 || v != std::get<0>(extra_edges[i - 1]) || w != std::get<1>(extra_edges[i - 1])) {
+                index.m_extra_targets.push_back(w);
+                ++index.m_extra_offsets[v + 1];
+                edge_runs.emplace_back();
+            }
+            add_color(edge_runs.back(), color);
+        }
+        for (std::size_t v = 0; v < cdbg.size(); ++v) index.m_extra_offsets[v + 1] += index.m_extra_offsets[v];
+
+        index.m_run_offsets.reserve(edge_runs.size() + 1);
+        for (auto& runs : edge_runs) {
+            index.m_runs.insert(index.m_runs.end(), runs.begin(), runs.end());
+            index.m_run_offsets.push_back(index.m_runs.size());
+            Utils::clear(runs);
+        }
+        return index;
+    }
+
+    bool save(const std::string& filename, uint64_t fingerprint) const {
+        std::ofstream ofs(filename, std::ios::binary);
+        if (!ofs) return false;
+        BinaryIO::write_header(ofs, MAGIC, VERSION, fingerprint);
+        BinaryIO::write_vector(ofs, m_extra_offsets);
+        BinaryIO::write_vector(ofs, m_extra_targets);
+        BinaryIO::write_vector(ofs, m_run_offsets);
+        BinaryIO::write_vector(ofs, m_runs);
+        BinaryIO::write_vector(ofs, m_n_nodes);
+        return (bool) ofs;
+    }
+
+    // Load the index from file. Fails if the index was built from a different graph or different edges files.
+    bool load(const CsrGraph& cdbg, const std::string& filename, uint64_t fingerprint) {
+        std::ifstream ifs(filename, std::ios::binary);
+        if (!ifs || !BinaryIO::read_header(ifs, MAGIC, VERSION, fingerprint)) return false;
+        if (!BinaryIO::read_vector(ifs, m_extra_offsets) || !BinaryIO::read_vector(ifs, m_extra_targets)) return false;
+        if (!BinaryIO::read_vector(ifs, m_run_offsets) || !BinaryIO::read_vector(ifs, m_runs) || !BinaryIO::read_vector(ifs, m_n_nodes)) return false;
+        m_n_cdbg_edges = cdbg.n_edge_indices();
+        return m_extra_offsets.size() == cdbg.size() + 1 && m_run_offsets.size() == m_n_cdbg_edges + m_extra_targets.size() + 1;
+    }
+
+private:
+    static constexpr const char* MAGIC = "UDCI";
+    static constexpr uint32_t VERSION = 2;
+
+    // Genomes read per thread in each batch when building the index.
+    static constexpr std::size_t BATCH_SIZE_PER_THREAD = 4;
+
+    int_t m_n_cdbg_edges;
+    std::vector<int_t> m_extra_offsets;
+    std::vector<node_t> m_extra_targets;
+
+    // Color runs in CSR format, the runs of edge_idx are in [m_run_offsets[edge_idx], m_run_offsets[edge_idx + 1]).
+    std::vector<int_t> m_run_offsets;
+    std::vector<ColorRun> m_runs;
+    std::vector<int_t> m_n_nodes;
+
+    static void add_color(std::vector<ColorRun>& runs, uint32_t color) {
+        if (!runs.empty() && runs.back().end == color) ++runs.back().end;
+        else runs.push_back({color, color + 1});
+    }
+
+    // The index is valid for the graph and the edges files it was built from.
+    static uint64_t input_fingerprint(const CsrGraph& cdbg, const std::vector<std::string>& edges_filenames) {
+        uint64_t hash = cdbg.fingerprint();
+        for (const auto& edges_filename : edges_filenames) {
+            hash = BinaryIO::hash_bytes(reinterpret_cast<const unsigned char*>(edges_filename.data()), edges_filename.size(), hash);
+            hash = BinaryIO::file_fingerprint(edges_filename, hash);
+        }
+        return hash;
+    }
+
+};
+
+/*
+    Edge-induced subgraph of the compacted de Bruijn graph for the genome with a given color, without
+    copying the graph. The edges of a node are the node's edges with the color, and the self-edge
+    between the node's sides if either side has such an edge, as if the subgraph had been constructed
+    from the genome's edges file.
+*/
+class ColoredSubgraph {
+public:
+    // Iterates over the node's edges in the compacted de Bruijn graph and then over its extra edges, skipping edges without the color.
+    class NeighborIterator {
+    public:
+        NeighborIterator(const ColoredSubgraph& subgraph, int_t v, int_t edge_idx, bool has_self_edge)
+        : m_subgraph(subgraph),
+          m_v(v),
+          m_edge_idx(edge_idx),
+          m_cdbg_end(subgraph.m_cdbg.edge_index_end(v)),
+          m_extra_begin(subgraph.m_index.extra_edge_index_begin(v)),
+          m_extra_end(subgraph.m_index.extra_edge_index_end(v)),
+          m_has_self_edge(has_self_edge),
+          m_neighbor()
+        {
+            skip_to_valid();
+        }
+
+        const std::pair<int_t, real_t>& operator*() const { return m_neighbor; }
+        const std::pair<int_t, real_t>* operator->() const { return &m_neighbor; }
+        NeighborIterator& operator++() { ++m_edge_idx; skip_to_valid(); return *this; }
+        bool operator==(const NeighborIterator& other) const { return m_edge_idx == other.m_edge_idx; }
+        bool operator!=(const NeighborIterator& other) const { return m_edge_idx != other.m_edge_idx; }
+
+    private:
+        const ColoredSubgraph& m_subgraph;
+        int_t m_v;
+        int_t m_edge_idx;
+        int_t m_cdbg_end;
+        int_t m_extra_begin;
+        int_t m_extra_end;
+        bool m_has_self_edge;
+        std::pair<int_t, real_t> m_neighbor;
+
+        // Advance to the next edge in the subgraph and set its weight.
+        void skip_to_valid() {
+            const auto& cdbg = m_subgraph.m_cdbg;
+            for ( ; m_edge_idx < m_cdbg_end; ++m_edge_idx) {
+                int_t w = cdbg.edge_target(m_edge_idx);
+                bool colored = m_subgraph.colored(m_edge_idx);
+                if (w == cdbg.other_side(m_v)) {
+                    if (!m_has_self_edge) continue;
+                    // An edge between the sides merges with the self-edge, keeping the shorter weight.
+                    real_t weight = cdbg.get_self_edge_weight(m_v);
+                    m_neighbor = std::make_pair(w, colored ? std::min(weight, (real_t) 1.0) : weight);
+                    return;
+                }
+                if (colored) {
+                    m_neighbor = std::make_pair(w, (real_t) 1.0); // Weight 1.0 by definition.
+                    return;
+                }
+            }
+            if (m_edge_idx < m_extra_begin) m_edge_idx = m_extra_begin;
+            for ( ; m_edge_idx < m_extra_end; ++m_edge_idx) {
+                if (!m_subgraph.colored(m_edge_idx)) continue;
+                m_neighbor = std::make_pair(m_subgraph.m_index.extra_edge_target(m_edge_idx), (real_t) 1.0);
+                return;
+            }
+        }
+    };
+
+    class Neighbors {
+    public:
+        Neighbors(NeighborIterator first, NeighborIterator last) : m_begin(first), m_end(last) { }
+        NeighborIterator begin() const { return m_begin; }
+        NeighborIterator end() const { return m_end; }
+    private:
+        NeighborIterator m_begin;
+        NeighborIterator m_end;
+    };
+
+    ColoredSubgraph(const CsrGraph& cdbg, const ColoredEdgeIndex& index, int_t color)
+    : m_cdbg(cdbg),
+      m_index(index),
+      m_color(color),
+      m_degrees(),
+      m_has_self_edge()
+    {
+        count_degrees();
+    }
+
+    std::size_t size() const { return m_index.n_nodes(m_color); }
+
+    int_t degree(int_t v) const { return m_degrees[v]; }
+
+    Neighbors operator[](int_t v) const { return Neighbors(begin(v), end(v)); }
+    NeighborIterator begin(int_t v) const { return NeighborIterator(*this, v, m_cdbg.edge_index_begin(v), m_has_self_edge[v / 2]); }
+    NeighborIterator end(int_t v) const { return NeighborIterator(*this, v, m_index.extra_edge_index_end(v), false); }
+
+private:
+    const CsrGraph& m_cdbg;
+    const ColoredEdgeIndex& m_index;
+    int_t m_color;
+    std::vector<int_t> m_degrees;
+    std::vector<bool> m_has_self_edge; // Either side of the unitig has an edge with the color.
+
+    bool colored(int_t edge_idx) const { return m_index.has_color(edge_idx, m_color); }
+
+    /*
+        Count the degrees of all nodes in a single pass over their edges, so that the path compression can
+        query degrees without filtering the edges by color again. The edge between a unitig's sides counts
+        if either side has an edge with the color.
+    */
+    void count_degrees() {
+        std::size_t sz = size();
+        std::vector<bool> has_colored_edge(sz), has_side_edge(sz);
+        m_degrees.assign(sz, 0);
+        for (std::size_t v = 0; v < sz; ++v) {
+            for (int_t i = m_cdbg.edge_index_begin(v); i < m_cdbg.edge_index_end(v); ++i) {
+                bool is_colored = colored(i);
+                if (is_colored) has_colored_edge[v] = true;
+                if (m_cdbg.edge_target(i) == m_cdbg.other_side(v)) has_side_edge[v] = true;
+                else m_degrees[v] += is_colored;
+            }
+            for (int_t i = m_index.extra_edge_index_begin(v); i < m_index.extra_edge_index_end(v); ++i) {
+                if (!colored(i)) continue;
+                has_colored_edge[v] = true;
+                ++m_degrees[v];
+            }
+        }
+        m_has_self_edge.resize(sz / 2);
+        for (std::size_t v = 0; v + 1 < sz; v += 2) {
+            m_has_self_edge[v / 2] = has_colored_edge[v] || has_colored_edge[v + 1];
+            if (!m_has_self_edge[v / 2]) continue;
+            m_degrees[v] += has_side_edge[v];
+            m_degrees[v + 1] += has_side_edge[v + 1];
+        }
+    }
+
+};
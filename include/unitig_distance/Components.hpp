@@ -0,0 +1,77 @@
+/*
+    Connected component labels of a graph, computed with a lock-free parallel union-find. Queries
+    between nodes in different components are answered without searching.
+*/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "CsrGraph.hpp"
+#include "ThreadPool.hpp"
+#include "types.hpp"
+
+class Components {
+public:
+    Components() : m_labels(), m_n_components(0) { }
+
+    std::size_t size() const { return m_labels.size(); }
+
+    std::size_t n_components() const { return m_n_components; }
+
+    bool connected(int_t v, int_t w) const { return m_labels[v] == m_labels[w]; }
+
+    static Components compute(const CsrGraph& graph, int_t n_threads = 1) {
+        std::size_t sz = graph.size();
+        std::vector<std::atomic<node_t>> parent(sz);
+
+        std::size_t stride = std::max<int_t>(n_threads, 1);
+        auto run_in_parallel = [stride](const std::function<void(std::size_t)>& f) { ThreadPool::instance().run(stride, f); };
+
+        run_in_parallel([&parent, sz, stride](std::size_t thr) { for (std::size_t v = thr; v < sz; v += stride) parent[v].store(v); });
+        run_in_parallel([&graph, &parent, sz, stride](std::size_t thr) {
+            for (std::size_t v = thr; v < sz; v += stride) {
+                for (auto neighbor : graph[v]) if ((int_t) v < neighbor.first) unite(parent, v, neighbor.first);
+            }
+        });
+
+        Components components;
+        components.m_labels.resize(sz);
+        run_in_parallel([&components, &parent, sz, stride](std::size_t thr) {
+            for (std::size_t v = thr; v < sz; v += stride) components.m_labels[v] = find(parent, v);
+        });
+        for (std::size_t v = 0; v < sz; ++v) components.m_n_components += components.m_labels[v] == (int_t) v;
+        return components;
+    }
+
+private:
+    std::vector<node_t> m_labels; // Root node of each node's component.
+    std::size_t m_n_components;
+
+    // Find the root of v, halving the path on the way.
+    static node_t find(std::vector<std::atomic<node_t>>& parent, node_t v) {
+        while (true) {
+            node_t p = parent[v].load();
+            if (p == v) return v;
+            node_t grandparent = parent[p].load();
+            if (grandparent != p) parent[v].compare_exchange_weak(p, grandparent);
+            v = grandparent;
+        }
+    }
+
+    // Link the root with the larger index under the other root. Retried if another thread changed the root meanwhile.
+    static void unite(std::vector<std::atomic<node_t>>& parent, node_t v, node_t w) {
+        while (true) {
+            v = find(parent, v);
+            w = find(parent, w);
+            if (v == w) return;
+            if (v < w) std::swap(v, w);
+            node_t expected = v;
+            if (parent[v].compare_exchange_strong(expected, w)) return;
+        }
+    }
+
+};
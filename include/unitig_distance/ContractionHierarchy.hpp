@@ -0,0 +1,276 @@
+/*
+    Contraction hierarchy (Geisberger et al. 2008) over the main graph, for repeated query campaigns
+    against a fixed graph. Nodes are contracted one by one in order of importance, adding shortcut
+    edges between their neighbors when no witness path exists. Only edges leading to more important
+    nodes are kept, and a query meets in the middle with two upward searches.
+    The index is built once with -chb [ --build-ch-index ] and written to a binary file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <queue>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "BinaryIO.hpp"
+#include "CsrGraph.hpp"
+#include "Graph.hpp"
+#include "SearchWorkspace.hpp"
+#include "ThreadPool.hpp"
+#include "types.hpp"
+#include "Utils.hpp"
+
+class ContractionHierarchy {
+public:
+    ContractionHierarchy() : m_offsets(1, 0), m_targets(), m_weights(), m_integer_weights(true) { }
+
+    std::size_t size() const { return m_offsets.size() - 1; }
+
+    std::size_t n_upward_edges() const { return m_targets.size(); }
+
+    static ContractionHierarchy build(const CsrGraph& graph, int_t n_threads) {
+        Builder builder(graph);
+        builder.run(n_threads);
+        ContractionHierarchy ch;
+        ch.m_integer_weights = graph.integer_weights();
+        builder.get_upward_graph(ch.m_offsets, ch.m_targets, ch.m_weights);
+        return ch;
+    }
+
+    /*
+        Compute the shortest distance from the sources to each set of target sources. The upward search from
+        the sources is done once, followed by one upward search per target set. Distances of at least
+        max_distance are returned as max_distance.
+    */
+    std::vector<real_t> distances(
+        const std::vector<std::pair<int_t, real_t>>& sources,
+        const std::vector<std::vector<std::pair<int_t, real_t>>>& target_sources,
+        real_t max_distance,
+        SearchWorkspace& workspace) const
+    {
+        workspace.reset(size(), max_distance);
+        if (m_integer_weights) return query(sources, target_sources, max_distance, workspace, workspace.radix_heap(), workspace.backward_radix_heap());
+        return query(sources, target_sources, max_distance, workspace, workspace.binary_heap(), workspace.backward_binary_heap());
+    }
+
+    bool save(const CsrGraph& graph, const std::string& filename) const {
+        std::ofstream ofs(filename, std::ios::binary);
+        if (!ofs) return false;
+        BinaryIO::write_header(ofs, MAGIC, VERSION, graph.fingerprint());
+        BinaryIO::write_value(ofs, (uint8_t) m_integer_weights);
+        BinaryIO::write_vector(ofs, m_offsets);
+        BinaryIO::write_vector(ofs, m_targets);
+        BinaryIO::write_vector(ofs, m_weights);
+        return (bool) ofs;
+    }
+
+    // Load the index from file. Fails if the index was built from a different graph.
+    bool load(const CsrGraph& graph, const std::string& filename) {
+        std::ifstream ifs(filename, std::ios::binary);
+        uint8_t integer_weights;
+        if (!ifs || !BinaryIO::read_header(ifs, MAGIC, VERSION, graph.fingerprint()) || !BinaryIO::read_value(ifs, integer_weights)) return false;
+        if (!BinaryIO::read_vector(ifs, m_offsets) || !BinaryIO::read_vector(ifs, m_targets) || !BinaryIO::read_vector(ifs, m_weights)) return false;
+        m_integer_weights = integer_weights;
+        return size() == graph.size();
+    }
+
+private:
+    static constexpr const char* MAGIC = "UDCH";
+    static constexpr uint32_t VERSION = 2;
+
+    // Upward graph in CSR format.
+    std::vector<int_t> m_offsets;
+    std::vector<node_t> m_targets;
+    std::vector<weight_t> m_weights;
+
+    bool m_integer_weights;
+
+    template <typename Queue>
+    std::vector<real_t> query(
+        const std::vector<std::pair<int_t, real_t>>& sources,
+        const std::vector<std::vector<std::pair<int_t, real_t>>>& target_sources,
+        real_t max_distance,
+        SearchWorkspace& workspace,
+        Queue& forward_queue,
+        Queue& backward_queue) const
+    {
+        // Forward upward search is explored completely, upward search spaces are small.
+        for (auto s : sources) {
+            if (s.second >= workspace.dist(s.first)) continue;
+            workspace.set_dist(s.first, s.second);
+            forward_queue.push(s.second, s.first);
+        }
+        while (!forward_queue.empty()) {
+            int_t v;
+            real_t v_dist;
+            std::tie(v_dist, v) = forward_queue.pop();
+            if (v_dist > workspace.dist(v)) continue; // Stale queue entry.
+            for (int_t i = m_offsets[v]; i < m_offsets[v + 1]; ++i) {
+                int_t w = m_targets[i];
+                real_t w_dist = v_dist + m_weights[i];
+                if (w_dist < workspace.dist(w)) {
+                    workspace.set_dist(w, w_dist);
+                    forward_queue.push(w_dist, w);
+                }
+            }
+        }
+
+        // Backward upward search for each target set meets the forward search space.
+        std::vector<real_t> target_dist;
+        for (const auto& targets : target_sources) {
+            workspace.reset_backward();
+            real_t best = max_distance;
+            for (auto t : targets) {
+                if (t.second >= workspace.backward_dist(t.first)) continue;
+                workspace.set_backward_dist(t.first, t.second);
+                backward_queue.push(t.second, t.first);
+            }
+            while (!backward_queue.empty()) {
+                int_t v;
+                real_t v_dist;
+                std::tie(v_dist, v) = backward_queue.pop();
+                if (v_dist > workspace.backward_dist(v)) continue; // Stale queue entry.
+                if (v_dist >= best) break; // No shorter path can be found.
+                best = std::min(best, v_dist + workspace.dist(v));
+                for (int_t i = m_offsets[v]; i < m_offsets[v + 1]; ++i) {
+                    int_t w = m_targets[i];
+                    real_t w_dist = v_dist + m_weights[i];
+                    if (w_dist < workspace.backward_dist(w)) {
+                        workspace.set_backward_dist(w, w_dist);
+                        backward_queue.push(w_dist, w);
+                    }
+                }
+            }
+            target_dist.push_back(best);
+        }
+        return target_dist;
+    }
+
+    // Contracts the nodes of a graph, collecting the upward edges.
+    class Builder {
+    public:
+        Builder(const CsrGraph& graph) : m_graph(graph.one_based()), m_upward(graph.size()), m_deleted_neighbors(graph.size()) {
+            m_graph.resize(graph.size());
+            for (std::size_t v = 0; v < graph.size(); ++v) {
+                for (auto neighbor : graph[v]) if (neighbor.first != (int_t) v) m_graph[v].push_back(neighbor);
+            }
+        }
+
+        void run(int_t n_threads) {
+            std::size_t sz = m_graph.size();
+
+            // Initial priorities are independent of each other and computed in parallel.
+            std::vector<int_t> priorities(sz);
+            auto compute_priorities = [this, &priorities, sz, n_threads](std::size_t thr) {
+                SearchWorkspace workspace;
+                for (std::size_t v = thr; v < sz; v += n_threads) priorities[v] = priority(v, workspace);
+            };
+            ThreadPool::instance().run(n_threads, compute_priorities);
+
+            using element_t = std::pair<int_t, int_t>; // (priority, node) pairs.
+            std::priority_queue<element_t, std::vector<element_t>, std::greater<element_t>> queue;
+            for (std::size_t v = 0; v < sz; ++v) queue.emplace(priorities[v], v);
+
+            // Contract nodes in order of priority. Priorities are updated lazily when a node comes up.
+            SearchWorkspace workspace;
+            while (!queue.empty()) {
+                int_t v = queue.top().second;
+                queue.pop();
+                auto v_priority = priority(v, workspace);
+                if (!queue.empty() && v_priority > queue.top().first) {
+                    queue.emplace(v_priority, v);
+                    continue;
+                }
+                contract(v, workspace);
+            }
+        }
+
+        void get_upward_graph(std::vector<int_t>& offsets, std::vector<node_t>& targets, std::vector<weight_t>& weights) const {
+            offsets.assign(1, 0);
+            targets.clear();
+            weights.clear();
+            for (const auto& adj : m_upward) {
+                for (const auto& neighbor : adj) {
+                    targets.push_back(neighbor.first);
+                    weights.push_back(neighbor.second);
+                }
+                offsets.push_back(targets.size());
+            }
+        }
+
+    private:
+        static constexpr int_t WITNESS_SEARCH_LIMIT = 500; // Settled nodes per witness search.
+
+        Graph m_graph; // Remaining graph, contracted nodes are disconnected.
+        std::vector<edges_t> m_upward;
+        std::vector<int_t> m_deleted_neighbors;
+
+        // Edge difference plus the number of already contracted neighbors, which spreads contraction evenly over the graph.
+        int_t priority(int_t v, SearchWorkspace& workspace) const {
+            return (int_t) find_shortcuts(v, workspace).size() - m_graph.degree(v) + m_deleted_neighbors[v];
+        }
+
+        // Shortcuts (u, w, weight) needed between the neighbors of v if v is contracted.
+        std::vector<std::tuple<int_t, int_t, real_t>> find_shortcuts(int_t v, SearchWorkspace& workspace) const {
+            std::vector<std::tuple<int_t, int_t, real_t>> shortcuts;
+            const auto& adj = m_graph[v];
+            for (std::size_t i = 0; i + 1 < adj.size(); ++i) {
+                int_t u = adj[i].first;
+                real_t uv_weight = adj[i].second;
+                real_t max_weight = 0.0;
+                for (std::size_t j = i + 1; j < adj.size(); ++j) max_weight = std::max(max_weight, uv_weight + adj[j].second);
+                witness_search(u, v, max_weight, workspace);
+                for (std::size_t j = i + 1; j < adj.size(); ++j) {
+                    int_t w = adj[j].first;
+                    real_t weight = uv_weight + adj[j].second;
+                    if (workspace.dist(w) > weight) shortcuts.emplace_back(u, w, weight);
+                }
+            }
+            return shortcuts;
+        }
+
+        // Limited search from u which avoids v. Distances that aren't found are overestimated, which only adds unnecessary shortcuts.
+        void witness_search(int_t u, int_t v, real_t max_weight, SearchWorkspace& workspace) const {
+            workspace.reset(m_graph.size(), REAL_T_MAX);
+            auto& queue = workspace.binary_heap();
+            workspace.set_dist(u, 0.0);
+            queue.push(0.0, u);
+            int_t n_settled = 0;
+            while (!queue.empty()) {
+                int_t x;
+                real_t x_dist;
+                std::tie(x_dist, x) = queue.pop();
+                if (x_dist > workspace.dist(x)) continue; // Stale queue entry.
+                if (x_dist > max_weight || ++n_settled > WITNESS_SEARCH_LIMIT) break;
+                for (const auto& neighbor : m_graph[x]) {
+                    int_t y = neighbor.first;
+                    real_t y_dist = x_dist + neighbor.second;
+                    if (y == v || y_dist > max_weight || y_dist >= workspace.dist(y)) continue;
+                    workspace.set_dist(y, y_dist);
+                    queue.push(y_dist, y);
+                }
+            }
+        }
+
+        void contract(int_t v, SearchWorkspace& workspace) {
+            auto shortcuts = find_shortcuts(v, workspace);
+            m_upward[v] = m_graph[v];
+            for (const auto& neighbor : m_graph[v]) ++m_deleted_neighbors[neighbor.first];
+            m_graph.disconnect_node(v);
+            Utils::clear(m_graph[v]);
+            for (const auto& shortcut : shortcuts) {
+                int_t u, w;
+                real_t weight;
+                std::tie(u, w, weight) = shortcut;
+                m_graph.add_edge(u, w, weight); // Keeps the shorter weight if the edge exists.
+            }
+        }
+
+    };
+
+};
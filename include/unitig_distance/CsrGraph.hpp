@@ -0,0 +1,675 @@
+/*
+    Immutable graph in compressed sparse row (CSR) format, frozen from a Graph after construction.
+    Adjacency is stored in three contiguous arrays (offsets, targets, weights), so the searches
+    don't need to chase a pointer for every settled node.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BinaryIO.hpp"
+#include "EdgeList.hpp"
+#include "Graph.hpp"
+#include "PriorityQueues.hpp"
+#include "SearchWorkspace.hpp"
+#include "types.hpp"
+#include "Utils.hpp"
+
+class CsrGraph {
+public:
+    // Search jobs with at most this many targets are solved with a bidirectional search per target.
+    static constexpr std::size_t BIDIRECTIONAL_MAX_TARGETS = 2;
+
+    // Number of sources advanced together by a multi-source breadth-first search, one bit per source.
+    static constexpr std::size_t BFS_BATCH_SIZE = 64;
+
+    // Iterates over (neighbor, weight) pairs of a node.
+    class NeighborIterator {
+    public:
+        NeighborIterator(const node_t* target, const weight_t* weight) : m_target(target), m_weight(weight) { }
+        std::pair<int_t, real_t> operator*() const { return std::make_pair(*m_target, *m_weight); }
+        NeighborIterator& operator++() { ++m_target; ++m_weight; return *this; }
+        bool operator==(const NeighborIterator& other) const { return m_target == other.m_target; }
+        bool operator!=(const NeighborIterator& other) const { return m_target != other.m_target; }
+    private:
+        const node_t* m_target;
+        const weight_t* m_weight;
+    };
+
+    class Neighbors {
+    public:
+        Neighbors(NeighborIterator first, NeighborIterator last) : m_begin(first), m_end(last) { }
+        NeighborIterator begin() const { return m_begin; }
+        NeighborIterator end() const { return m_end; }
+    private:
+        NeighborIterator m_begin;
+        NeighborIterator m_end;
+    };
+
+    CsrGraph() : CsrGraph(false, false) { }
+    CsrGraph(bool one_based, bool two_sided)
+    : m_offsets(1, 0), m_targets(), m_weights(), m_self_edge_weights(), m_order(), m_one_based(one_based), m_two_sided(two_sided), m_integer_weights(true), m_unit_weights(true)
+    { }
+
+    explicit CsrGraph(const Graph& graph)
+    : m_offsets(),
+      m_targets(),
+      m_weights(),
+      m_self_edge_weights(),
+      m_order(),
+      m_one_based(graph.one_based()),
+      m_two_sided(graph.two_sided()),
+      m_integer_weights(true),
+      m_unit_weights(true)
+    {
+        m_offsets.reserve(graph.size() + 1);
+        m_offsets.push_back(0);
+        for (const auto& adj : graph) m_offsets.push_back(m_offsets.back() + adj.size());
+        m_targets.reserve(m_offsets.back());
+        m_weights.reserve(m_offsets.back());
+        for (const auto& adj : graph) {
+            for (const auto& neighbor : adj) {
+                m_targets.push_back(neighbor.first);
+                m_weights.push_back(neighbor.second);
+            }
+        }
+        if (two_sided()) {
+            m_self_edge_weights.reserve(graph.true_size());
+            for (std::size_t v = 0; v < graph.true_size(); ++v) m_self_edge_weights.push_back(graph.get_self_edge_weight(graph.left_node(v)));
+        }
+        m_integer_weights = std::all_of(m_weights.begin(), m_weights.end(), is_integer_weight);
+        m_unit_weights = std::all_of(m_weights.begin(), m_weights.end(), is_unit_weight);
+    }
+
+    bool contains(int_t v) const { return v < (int_t) size(); }
+
+    // Index of an original node in the graph, which differs from the original index only if the nodes were reordered.
+    int_t reordered_node(int_t v) const { return v < (int_t) m_order.size() ? m_order[v] : v; }
+
+    /*
+        Renumber the nodes in reverse Cuthill-McKee order, which places neighboring nodes close to each other
+        in memory. Both sides of a two-sided node are kept next to each other. Map original node indices with
+        reordered_node() afterwards.
+    */
+    void reorder_nodes() {
+        std::size_t n = two_sided() ? true_size() : size();
+        auto unit = [this](int_t v) { return two_sided() ? v / 2 : v; };
+        auto unit_degree = [this](int_t u) { return two_sided() ? degree(left_node(u)) + degree(right_node(u)) : degree(u); };
+
+        // Cuthill-McKee: breadth-first search from a node of minimum degree in each component, visiting neighbors in order of degree.
+        std::vector<int_t> units(n);
+        for (std::size_t u = 0; u < n; ++u) units[u] = u;
+        std::stable_sort(units.begin(), units.end(), [&unit_degree](int_t a, int_t b) { return unit_degree(a) < unit_degree(b); });
+        std::vector<int_t> cm_order;
+        std::vector<bool> visited(n);
+        cm_order.reserve(n);
+        for (auto start : units) {
+            if (visited[start]) continue;
+            visited[start] = true;
+            cm_order.push_back(start);
+            for (std::size_t head = cm_order.size() - 1; head < cm_order.size(); ++head) {
+                int_t u = cm_order[head];
+                std::vector<int_t> neighbors;
+                for (int_t side = two_sided() ? left_node(u) : u; side <= (two_sided() ? right_node(u) : u); ++side) {
+                    for (int_t i = m_offsets[side]; i < m_offsets[side + 1]; ++i) {
+                        int_t x = unit(m_targets[i]);
+                        if (visited[x]) continue;
+                        visited[x] = true;
+                        neighbors.push_back(x);
+                    }
+                }
+                std::stable_sort(neighbors.begin(), neighbors.end(), [&unit_degree](int_t a, int_t b) { return unit_degree(a) < unit_degree(b); });
+                cm_order.insert(cm_order.end(), neighbors.begin(), neighbors.end());
+            }
+        }
+
+        // Reversing the order gives a smaller bandwidth.
+        std::vector<node_t> order(n);
+        for (std::size_t i = 0; i < n; ++i) order[cm_order[n - 1 - i]] = i;
+
+        // Compose with an earlier reordering.
+        if (!m_order.empty()) for (auto& u : m_order) u = order[u];
+        else m_order = order;
+
+        auto new_node = [this, &order](int_t v) { return two_sided() ? 2 * order[v / 2] + (v & 1) : order[v]; };
+        std::vector<int_t> old_node(size());
+        for (std::size_t v = 0; v < size(); ++v) old_node[new_node(v)] = v;
+
+        std::vector<int_t> offsets(1, 0);
+        std::vector<node_t> targets;
+        std::vector<weight_t> weights;
+        offsets.reserve(size() + 1);
+        targets.reserve(m_targets.size());
+        weights.reserve(m_weights.size());
+        for (std::size_t v = 0; v < size(); ++v) {
+            int_t old_v = old_node[v];
+            for (int_t i = m_offsets[old_v]; i < m_offsets[old_v + 1]; ++i) {
+                targets.push_back(new_node(m_targets[i]));
+                weights.push_back(m_weights[i]);
+            }
+            offsets.push_back(targets.size());
+        }
+        m_offsets = std::move(offsets);
+        m_targets = std::move(targets);
+        m_weights = std::move(weights);
+
+        if (two_sided()) {
+            std::vector<weight_t> self_edge_weights(true_size());
+            for (std::size_t u = 0; u < true_size(); ++u) self_edge_weights[order[u]] = m_self_edge_weights[u];
+            m_self_edge_weights = std::move(self_edge_weights);
+        }
+    }
+
+    int_t degree(int_t v) const { return m_offsets[v + 1] - m_offsets[v]; }
+
+    std::size_t size() const { return m_offsets.size() - 1; }
+
+    // Number of undirected edges.
+    std::size_t n_edges() const { return m_targets.size() / 2; }
+
+    // Useful functions if graph stores two sides for each node.
+    std::size_t true_size() const { return size() / 2; }
+    int_t left_node(int_t v) const { return v * 2; }
+    int_t right_node(int_t v) const { return v * 2 + 1; }
+    int_t other_side(int_t v) const { return v ^ 1; }
+    real_t get_self_edge_weight(int_t v) const { return two_sided() ? m_self_edge_weights[v / 2] : 0.0; }
+    bool one_based() const { return m_one_based; }
+    bool two_sided() const { return m_two_sided; }
+
+    // All edge weights are integers, e.g. in compacted de Bruijn graphs. Searches then use a radix heap.
+    bool integer_weights() const { return m_integer_weights; }
+
+    // All edge weights are 1, e.g. in general graphs without a weight column. Search jobs can then be batched into multi-source breadth-first searches.
+    bool unit_weights() const { return m_unit_weights; }
+
+    // Hash of the graph structure, used to check that index files on disk were built from this graph.
+    uint64_t fingerprint() const {
+        uint64_t hash = BinaryIO::hash(m_offsets);
+        hash = BinaryIO::hash(m_targets, hash);
+        hash = BinaryIO::hash(m_weights, hash);
+        hash = BinaryIO::hash(m_self_edge_weights, hash);
+        hash = BinaryIO::hash(m_order, hash);
+        return hash ^ (uint64_t) two_sided();
+    }
+
+    // Write the graph to a binary cache file. The fingerprint identifies the input files the graph was constructed from.
+    bool save(const std::string& filename, uint64_t input_fingerprint) const {
+        std::ofstream ofs(filename, std::ios::binary);
+        if (!ofs) return false;
+        BinaryIO::write_header(ofs, MAGIC, VERSION, input_fingerprint);
+        BinaryIO::write_value(ofs, (uint8_t) m_one_based);
+        BinaryIO::write_value(ofs, (uint8_t) m_two_sided);
+        BinaryIO::write_value(ofs, (uint8_t) m_integer_weights);
+        BinaryIO::write_vector(ofs, m_offsets);
+        BinaryIO::write_vector(ofs, m_targets);
+        BinaryIO::write_vector(ofs, m_weights);
+        BinaryIO::write_vector(ofs, m_self_edge_weights);
+        BinaryIO::write_vector(ofs, m_order);
+        return (bool) ofs;
+    }
+
+    // Load the graph from a memory-mapped binary cache file. Fails if the file was saved from different input files.
+    bool load(const std::string& filename, uint64_t input_fingerprint) {
+        MappedFile file(filename);
+        uint8_t one_based, two_sided, integer_weights;
+        if (!file.read_header(MAGIC, VERSION, input_fingerprint)) return false;
+        if (!file.read_value(one_based) || !file.read_value(two_sided) || !file.read_value(integer_weights)) return false;
+        if (!file.read_vector(m_offsets) || !file.read_vector(m_targets) || !file.read_vector(m_weights)) return false;
+        if (!file.read_vector(m_self_edge_weights) || !file.read_vector(m_order)) return false;
+        m_one_based = one_based;
+        m_two_sided = two_sided;
+        m_integer_weights = integer_weights;
+        m_unit_weights = std::all_of(m_weights.begin(), m_weights.end(), is_unit_weight);
+        return valid_structure();
+    }
+
+    // Convert back to a mutable graph, e.g. for compressing its paths.
+    Graph to_graph() const {
+        Graph graph(one_based(), two_sided());
+        if (two_sided()) {
+            for (auto self_edge_weight : m_self_edge_weights) graph.add_two_sided_node(self_edge_weight);
+        } else {
+            graph.resize(size());
+        }
+        EdgeList edges;
+        for (std::size_t v = 0; v < size(); ++v) {
+            for (int_t i = m_offsets[v]; i < m_offsets[v + 1]; ++i) if ((int_t) v < m_targets[i]) edges.add_edge(v, m_targets[i], m_weights[i]);
+        }
+        edges.build(graph);
+        return graph;
+    }
+
+    // Print details about the graph.
+    void print_details() const {
+        int_t n_nodes = 0, n_edges = 0, max_degree = 0;
+        for (std::size_t i = 0; i < size(); ++i) {
+            auto sz = degree(i);
+            if (two_sided()) {
+                sz += degree(i + 1);
+                if (sz >= 2) sz -= 2; // Remove "self-edge" from these calculations.
+                ++i;
+            }
+            n_nodes += sz > 0;
+            n_edges += sz;
+            max_degree = std::max(max_degree, sz);
+        }
+        std::string out_str = "Graph has " +  Utils::neat_number_str(n_nodes) + " connected" + (two_sided() ? " (half) " : " ") + "nodes and "
+                            + Utils::neat_number_str(n_edges / 2) + " edges. Avg and max degree are "
+                            + Utils::neat_decimal_str(n_edges, n_nodes) + " and " + std::to_string(max_degree) + ".";
+        std::cout << out_str << std::endl;
+    }
+
+    // Edges are indexed by their position in the adjacency arrays, so that data can be attached to them. Each direction has its own index.
+    std::size_t n_edge_indices() const { return m_targets.size(); }
+    int_t edge_index_begin(int_t v) const { return m_offsets[v]; }
+    int_t edge_index_end(int_t v) const { return m_offsets[v + 1]; }
+    int_t edge_target(int_t edge_idx) const { return m_targets[edge_idx]; }
+
+    // Index of edge (v, w), -1 if there is no such edge.
+    int_t edge_index(int_t v, int_t w) const {
+        for (int_t i = m_offsets[v]; i < m_offsets[v + 1]; ++i) if (m_targets[i] == w) return i;
+        return -1;
+    }
+
+    // Accessors and iterators.
+    Neighbors operator[](std::size_t idx) const { return Neighbors(begin(idx), end(idx)); }
+    NeighborIterator begin(int_t v) const { return NeighborIterator(m_targets.data() + m_offsets[v], m_weights.data() + m_offsets[v]); }
+    NeighborIterator end(int_t v) const { return NeighborIterator(m_targets.data() + m_offsets[v + 1], m_weights.data() + m_offsets[v + 1]); }
+
+    // Compute the shortest distance between a source and a target.
+    real_t distance(int_t source, int_t target, real_t max_distance = REAL_T_MAX) const {
+        return distance(std::vector<std::pair<int_t, real_t>>{{source, 0.0}}, std::vector<int_t>{target}, max_distance).front();
+    }
+
+    // Compute shortest distance between source(s) and targets.
+    std::vector<real_t> distance(
+        const std::vector<std::pair<int_t, real_t>>& sources,
+        const std::vector<int_t>& targets,
+        real_t max_distance = REAL_T_MAX) const
+    {
+        SearchWorkspace workspace;
+        return distance(sources, targets, max_distance, workspace);
+    }
+
+    // Compute shortest distance between source(s) and targets, reusing the caller's workspace.
+    std::vector<real_t> distance(
+        const std::vector<std::pair<int_t, real_t>>& sources,
+        const std::vector<int_t>& targets,
+        real_t max_distance,
+        SearchWorkspace& workspace) const
+    {
+        if (two_sided()) return distance<true>(sources, targets, max_distance, workspace);
+        return distance<false>(sources, targets, max_distance, workspace);
+    }
+
+    // As above, with the sidedness of the graph fixed at compile time by a caller that dispatches on two_sided() once.
+    template <bool TwoSided>
+    std::vector<real_t> distance(
+        const std::vector<std::pair<int_t, real_t>>& sources,
+        const std::vector<int_t>& targets,
+        real_t max_distance,
+        SearchWorkspace& workspace) const
+    {
+        workspace.reset(size(), max_distance);
+        if (integer_weights()) return dijkstra<TwoSided>(sources, targets, workspace, workspace.radix_heap());
+        return dijkstra<TwoSided>(sources, targets, workspace, workspace.binary_heap());
+    }
+
+    // Compute distances from source(s) to all nodes. Unreachable nodes have distance REAL_T_MAX.
+    std::vector<real_t> all_distances(const std::vector<std::pair<int_t, real_t>>& sources, SearchWorkspace& workspace) const {
+        workspace.reset(size(), REAL_T_MAX);
+        // Sidedness only matters for targets.
+        if (integer_weights()) dijkstra<false>(sources, std::vector<int_t>(), workspace, workspace.radix_heap());
+        else dijkstra<false>(sources, std::vector<int_t>(), workspace, workspace.binary_heap());
+        std::vector<real_t> dist(size());
+        for (std::size_t v = 0; v < size(); ++v) dist[v] = workspace.dist(v);
+        return dist;
+    }
+
+    /*
+        Compute shortest distance between source(s) and targets with A*. The heuristic must be a consistent
+        lower bound for the distance from a node to the closest target, e.g. a landmark (ALT) bound.
+    */
+    template <typename Heuristic>
+    std::vector<real_t> astar_distance(
+        const std::vector<std::pair<int_t, real_t>>& sources,
+        const std::vector<int_t>& targets,
+        real_t max_distance,
+        SearchWorkspace& workspace,
+        const Heuristic& heuristic) const
+    {
+        if (two_sided()) return astar_distance<true>(sources, targets, max_distance, workspace, heuristic);
+        return astar_distance<false>(sources, targets, max_distance, workspace, heuristic);
+    }
+
+    template <bool TwoSided, typename Heuristic>
+    std::vector<real_t> astar_distance(
+        const std::vector<std::pair<int_t, real_t>>& sources,
+        const std::vector<int_t>& targets,
+        real_t max_distance,
+        SearchWorkspace& workspace,
+        const Heuristic& heuristic) const
+    {
+        workspace.reset(size(), max_distance);
+        if (integer_weights()) return astar<TwoSided>(sources, targets, max_distance, workspace, workspace.radix_heap(), heuristic);
+        return astar<TwoSided>(sources, targets, max_distance, workspace, workspace.binary_heap(), heuristic);
+    }
+
+    /*
+        Compute the shortest distance between two sets of sources with a bidirectional search,
+        i.e. the minimum of initial distance + path length + initial distance over all pairs.
+        Returns max_distance if the distance is at least max_distance.
+    */
+    real_t bidirectional_distance(
+        const std::vector<std::pair<int_t, real_t>>& sources,
+        const std::vector<std::pair<int_t, real_t>>& backward_sources,
+        real_t max_distance,
+        SearchWorkspace& workspace) const
+    {
+        workspace.reset(size(), max_distance);
+        if (integer_weights()) return bidirectional_dijkstra(sources, backward_sources, max_distance, workspace, workspace.radix_heap(), workspace.backward_radix_heap());
+        return bidirectional_dijkstra(sources, backward_sources, max_distance, workspace, workspace.binary_heap(), workspace.backward_binary_heap());
+    }
+
+    /*
+        Compute the distances from up to BFS_BATCH_SIZE sources to their own targets with one breadth-first
+        search in a one-sided graph with unit weights. Each node keeps a bitset of the sources that have
+        reached it, so a single scan of a node's neighbors advances all sources at once. targets[i] are the
+        targets of sources[i], and the distances are returned in the same layout. Distances of at least
+        max_distance are returned as max_distance. Sources drop out of the search once their targets are found.
+    */
+    std::vector<std::vector<real_t>> multi_source_bfs(
+        const std::vector<int_t>& sources,
+        const std::vector<std::vector<int_t>>& targets,
+        real_t max_distance,
+        SearchWorkspace& workspace) const
+    {
+        auto& bfs = workspace.bfs_bitsets(size());
+        std::vector<std::vector<real_t>> target_dist(sources.size());
+        std::vector<std::size_t> targets_left(sources.size());
+        uint64_t active = 0;
+        for (std::size_t i = 0; i < sources.size(); ++i) {
+            target_dist[i].assign(targets[i].size(), max_distance);
+            targets_left[i] = targets[i].size();
+            if (targets_left[i] > 0) active |= (uint64_t) 1 << i;
+            for (std::size_t j = 0; j < targets[i].size(); ++j) {
+                int_t w = targets[i][j];
+                bfs.targets.push_back({(int_t) i, (int_t) j, bfs.target_head[w]});
+                bfs.target_head[w] = bfs.targets.size() - 1;
+                bfs.target_of[w] |= (uint64_t) 1 << i;
+            }
+        }
+
+        // Move the nodes reached on the next level to the current level and record the distances of reached targets.
+        auto advance = [&bfs, &target_dist, &targets_left, &active](real_t level) {
+            for (auto v : bfs.upcoming) {
+                uint64_t reached = bfs.next[v];
+                bfs.next[v] = 0;
+                if (bfs.seen[v] == 0) bfs.visited.push_back(v);
+                bfs.seen[v] |= reached;
+                bfs.frontier[v] = reached;
+                bfs.current.push_back(v);
+                if ((reached & bfs.target_of[v]) == 0) continue;
+                for (int_t e = bfs.target_head[v]; e != -1; e = bfs.targets[e].next) {
+                    const auto& target = bfs.targets[e];
+                    if ((reached >> target.source & 1) == 0) continue;
+                    target_dist[target.source][target.target_idx] = level;
+                    if (--targets_left[target.source] == 0) active &= ~((uint64_t) 1 << target.source);
+                }
+            }
+            bfs.upcoming.clear();
+        };
+
+        for (std::size_t i = 0; i < sources.size(); ++i) {
+            int_t s = sources[i];
+            if (bfs.next[s] == 0) bfs.upcoming.push_back(s);
+            bfs.next[s] |= (uint64_t) 1 << i;
+        }
+        real_t level = 0.0;
+        advance(level);
+        while (active != 0 && !bfs.current.empty() && ++level < max_distance) {
+            for (auto v : bfs.current) {
+                uint64_t reaching = bfs.frontier[v] & active;
+                bfs.frontier[v] = 0;
+                if (reaching == 0) continue;
+                for (int_t i = m_offsets[v]; i < m_offsets[v + 1]; ++i) {
+                    int_t w = m_targets[i];
+                    uint64_t reached = reaching & ~bfs.seen[w];
+                    if (reached == 0) continue;
+                    if (bfs.next[w] == 0) bfs.upcoming.push_back(w);
+                    bfs.next[w] |= reached;
+                }
+            }
+            bfs.current.clear();
+            advance(level);
+        }
+
+        // Clear the bitsets of the touched nodes for the next search.
+        for (auto v : bfs.current) bfs.frontier[v] = 0;
+        for (auto v : bfs.visited) bfs.seen[v] = 0;
+        for (const auto& ws : targets) {
+            for (auto w : ws) {
+                bfs.target_of[w] = 0;
+                bfs.target_head[w] = -1;
+            }
+        }
+        bfs.current.clear();
+        bfs.visited.clear();
+        bfs.targets.clear();
+        return target_dist;
+    }
+
+private:
+    static constexpr const char* MAGIC = "UDGR";
+    static constexpr uint32_t VERSION = 2;
+
+    std::vector<int_t> m_offsets; // Neighbors of v are stored in [m_offsets[v], m_offsets[v + 1]).
+    std::vector<node_t> m_targets;
+    std::vector<weight_t> m_weights;
+
+    // Filled if graph nodes are two-sided.
+    std::vector<weight_t> m_self_edge_weights;
+
+    // Filled if the nodes were reordered. Maps original node indices to their current indices.
+    std::vector<node_t> m_order;
+
+    bool m_one_based;
+    bool m_two_sided;
+    bool m_integer_weights;
+    bool m_unit_weights;
+
+    // Integer weights are also limited to the range where distances (real_t) represent integers exactly, i.e. below 2^digits.
+    static bool is_integer_weight(real_t weight) {
+        static const real_t max_exact = (real_t) (uint64_t(1) << std::numeric_limits<real_t>::digits);
+        return weight >= 0.0 && weight < max_exact && std::floor(weight) == weight;
+    }
+
+    static bool is_unit_weight(real_t weight) { return weight == 1.0; }
+
+    // Check that the arrays of a loaded graph are consistent, so that a damaged cache file can't cause out of bounds accesses.
+    bool valid_structure() const {
+        if (m_offsets.empty() || m_offsets.front() != 0 || !std::is_sorted(m_offsets.begin(), m_offsets.end())) return false;
+        if ((std::size_t) m_offsets.back() != m_targets.size() || m_weights.size() != m_targets.size()) return false;
+        if (!std::all_of(m_targets.begin(), m_targets.end(), [this](int_t w) { return w >= 0 && w < (int_t) size(); })) return false;
+        if (two_sided() ? size() % 2 != 0 || m_self_edge_weights.size() != true_size() : !m_self_edge_weights.empty()) return false;
+        // The order maps units, i.e. two-sided nodes as a whole, so it has true_size() entries in two-sided graphs.
+        std::size_t n_units = two_sided() ? true_size() : size();
+        if (!m_order.empty() && m_order.size() != n_units) return false;
+        return std::all_of(m_order.begin(), m_order.end(), [n_units](int_t u) { return u >= 0 && u < (int_t) n_units; });
+    }
+
+    // The search kernels are specialised for the sidedness of the graph, so that the inner loops don't branch on it.
+    template <bool TwoSided, typename Queue>
+    std::vector<real_t> dijkstra(
+        const std::vector<std::pair<int_t, real_t>>& sources,
+        const std::vector<int_t>& targets,
+        SearchWorkspace& workspace,
+        Queue& queue) const
+    {
+        for (auto w : targets) workspace.set_target(w);
+        int_t targets_left = targets.size();
+
+        for (auto s : sources) {
+            int_t v;
+            real_t initial_distance;
+            std::tie(v, initial_distance) = s;
+            workspace.set_dist(v, initial_distance);
+            queue.push(initial_distance, v);
+        }
+
+        // Start search.
+        while (!queue.empty()) {
+            int_t v;
+            real_t v_dist;
+            std::tie(v_dist, v) = queue.pop();
+            if (v_dist > workspace.dist(v)) continue; // Stale queue entry.
+            if (workspace.is_target(v)) {
+                --targets_left;
+                workspace.unset_target(v);
+                if (TwoSided) {
+                    --targets_left;
+                    workspace.unset_target(other_side(v));
+                }
+                if (targets_left == 0) break; // Calculated distances for all targets.
+            }
+            for (int_t i = m_offsets[v]; i < m_offsets[v + 1]; ++i) {
+                int_t w = m_targets[i];
+                real_t w_dist = v_dist + m_weights[i];
+                if (w_dist < workspace.dist(w)) {
+                    workspace.set_dist(w, w_dist);
+                    queue.push(w_dist, w);
+                }
+            }
+        }
+        std::vector<real_t> target_dist;
+        for (auto target : targets) target_dist.push_back(workspace.dist(target));
+        return target_dist;
+    }
+
+    template <bool TwoSided, typename Queue, typename Heuristic>
+    std::vector<real_t> astar(
+        const std::vector<std::pair<int_t, real_t>>& sources,
+        const std::vector<int_t>& targets,
+        real_t max_distance,
+        SearchWorkspace& workspace,
+        Queue& queue,
+        const Heuristic& heuristic) const
+    {
+        // Potentials are cached, so the heuristic is evaluated at most once per node.
+        auto potential = [&workspace, &heuristic](int_t v) {
+            if (!workspace.has_potential(v)) workspace.set_potential(v, heuristic(v));
+            return workspace.potential(v);
+        };
+
+        for (auto w : targets) workspace.set_target(w);
+        int_t targets_left = targets.size();
+
+        for (auto s : sources) {
+            int_t v;
+            real_t initial_distance;
+            std::tie(v, initial_distance) = s;
+            real_t estimate = initial_distance + potential(v);
+            if (estimate >= max_distance || initial_distance >= workspace.dist(v)) continue;
+            workspace.set_dist(v, initial_distance);
+            queue.push(estimate, v);
+        }
+
+        // Start search, queue is ordered by distance + potential.
+        while (!queue.empty()) {
+            int_t v;
+            real_t v_estimate;
+            std::tie(v_estimate, v) = queue.pop();
+            real_t v_dist = workspace.dist(v);
+            if (v_estimate > v_dist + workspace.potential(v)) continue; // Stale queue entry.
+            if (workspace.is_target(v)) {
+                --targets_left;
+                workspace.unset_target(v);
+                if (TwoSided) {
+                    --targets_left;
+                    workspace.unset_target(other_side(v));
+                }
+                if (targets_left == 0) break; // Calculated distances for all targets.
+            }
+            for (int_t i = m_offsets[v]; i < m_offsets[v + 1]; ++i) {
+                int_t w = m_targets[i];
+                real_t w_dist = v_dist + m_weights[i];
+                if (w_dist >= workspace.dist(w)) continue;
+                real_t w_estimate = w_dist + potential(w);
+                if (w_estimate >= max_distance) continue; // Can't reach a target within max_distance through w.
+                workspace.set_dist(w, w_dist);
+                queue.push(w_estimate, w);
+            }
+        }
+        std::vector<real_t> target_dist;
+        for (auto target : targets) target_dist.push_back(workspace.dist(target));
+        return target_dist;
+    }
+
+    template <typename Queue>
+    real_t bidirectional_dijkstra(
+        const std::vector<std::pair<int_t, real_t>>& sources,
+        const std::vector<std::pair<int_t, real_t>>& backward_sources,
+        real_t max_distance,
+        SearchWorkspace& workspace,
+        Queue& forward_queue,
+        Queue& backward_queue) const
+    {
+        real_t best = max_distance;
+        for (auto s : sources) {
+            if (s.second >= workspace.dist(s.first)) continue;
+            workspace.set_dist(s.first, s.second);
+            forward_queue.push(s.second, s.first);
+        }
+        for (auto s : backward_sources) {
+            if (s.second >= workspace.backward_dist(s.first)) continue;
+            workspace.set_backward_dist(s.first, s.second);
+            backward_queue.push(s.second, s.first);
+            best = std::min(best, workspace.dist(s.first) + s.second);
+        }
+
+        // Alternate between the searches by expanding the one with the closer queue top. Stop when no shorter path can be found.
+        while (!forward_queue.empty() && !backward_queue.empty()) {
+            real_t forward_top = forward_queue.top_distance();
+            real_t backward_top = backward_queue.top_distance();
+            if (forward_top + backward_top >= best) break;
+            if (forward_top <= backward_top) {
+                best = std::min(best, bidirectional_step<false>(forward_queue, workspace));
+            } else {
+                best = std::min(best, bidirectional_step<true>(backward_queue, workspace));
+            }
+        }
+        return best;
+    }
+
+    // Settle one node in one direction of a bidirectional search. Returns the shortest path length found through the relaxed edges.
+    template <bool Backward, typename Queue>
+    real_t bidirectional_step(Queue& queue, SearchWorkspace& workspace) const {
+        auto dist = [&workspace](int_t v) { return Backward ? workspace.backward_dist(v) : workspace.dist(v); };
+        auto other_dist = [&workspace](int_t v) { return Backward ? workspace.dist(v) : workspace.backward_dist(v); };
+        real_t best = REAL_T_MAX;
+        int_t v;
+        real_t v_dist;
+        std::tie(v_dist, v) = queue.pop();
+        if (v_dist > dist(v)) return best; // Stale queue entry.
+        for (int_t i = m_offsets[v]; i < m_offsets[v + 1]; ++i) {
+            int_t w = m_targets[i];
+            real_t w_dist = v_dist + m_weights[i];
+            if (w_dist < dist(w)) {
+                if (Backward) workspace.set_backward_dist(w, w_dist);
+                else workspace.set_dist(w, w_dist);
+                queue.push(w_dist, w);
+            }
+            best = std::min(best, w_dist + other_dist(w));
+        }
+        return best;
+    }
+
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+
 #include "types.hpp"
 
 class Distance {
@@ -24,12 +26,12 @@ public:
     void set_distance(real_t distance) { m_distance = distance; }
     void set_count(int_t count) { m_count = count; }
 
-    Distance operator+(const Distance& other) {
+    Distance operator+(const Distance& other) const {
         auto distance_1 = distance();
         auto count_1 = count();
         auto distance_2 = other.distance();
         auto count_2 = other.count();
-        
+
         auto new_count = count_1 + count_2;
         auto new_distance = (distance_1 * count_1 + distance_2 * count_2) / new_count;
         // Need to use member variables directly here.
@@ -44,6 +46,20 @@ public:
         return *this = *this + other;
     }
 
+    /*
+        Combine the statistics of two disjoint sets of distances with the parallel update of Chan et al., e.g. to merge
+        accumulators that were filled with operator+= in different threads.
+    */
+    Distance merge(const Distance& other) const {
+        if (other.count() == 0) return *this;
+        if (count() == 0) return other;
+        auto new_count = count() + other.count();
+        auto delta = other.distance() - distance();
+        auto new_distance = distance() + delta * other.count() / new_count;
+        auto new_m2 = m_m2 + other.m_m2 + delta * delta * count() * other.count() / new_count;
+        return Distance(new_distance, new_count, new_m2, std::min(m_min, other.m_min), std::max(m_max, other.m_max));
+    }
+
     operator real_t() const { return m_distance; }
 
 private:
@@ -0,0 +1,66 @@
+/*
+    Bulk graph construction. Edges are collected into a flat array, deduplicated with a parallel
+    sort that keeps the shortest weight of each edge, and written to the adjacency lists in one pass.
+    This avoids scanning an adjacency list for every edge read from the input, as Graph::add_edge does.
+*/
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <tuple>
+#include <vector>
+
+#include "Graph.hpp"
+#include "types.hpp"
+#include "Utils.hpp"
+
+class EdgeList {
+public:
+    std::size_t size() const { return m_edges.size(); }
+
+    // Self-loops are ignored like in Graph::add_edge.
+    void add_edge(int_t v, int_t w, real_t weight) {
+        if (v == w) return;
+        Utils::check_weight(weight);
+        if (v > w) std::swap(v, w);
+        m_edges.emplace_back(v, w, weight);
+    }
+
+    // Edges read in parallel are collected into separate lists and appended together.
+    void append(const EdgeList& other) { m_edges.insert(m_edges.end(), other.m_edges.begin(), other.m_edges.end()); }
+
+    // Move the edges into the graph, merging them with the graph's existing edges (such as two-sided nodes' self-edges).
+    void build(Graph& graph, int_t n_threads = 1) {
+        for (std::size_t v = 0; v < graph.size(); ++v) {
+            for (const auto& neighbor : graph[v]) if ((int_t) v < neighbor.first) m_edges.emplace_back(v, neighbor.first, neighbor.second);
+            Utils::clear(graph[v]);
+        }
+
+        // Sort by (v, w, weight), so that the first copy of each edge has the shortest weight.
+        Utils::parallel_sort(m_edges, std::less<edge_t>(), n_threads);
+        auto last = std::unique(m_edges.begin(), m_edges.end(), [](const edge_t& a, const edge_t& b) {
+            return std::get<0>(a) == std::get<0>(b) && std::get<1>(a) == std::get<1>(b);
+        });
+        m_edges.erase(last, m_edges.end());
+
+        std::vector<int_t> degrees(graph.size());
+        for (const auto& edge : m_edges) {
+            ++degrees[std::get<0>(edge)];
+            ++degrees[std::get<1>(edge)];
+        }
+        for (std::size_t v = 0; v < graph.size(); ++v) graph[v].reserve(degrees[v]);
+        for (const auto& edge : m_edges) {
+            int_t v, w;
+            real_t weight;
+            std::tie(v, w, weight) = edge;
+            graph[v].emplace_back(w, weight);
+            graph[w].emplace_back(v, weight);
+        }
+        Utils::clear(m_edges);
+    }
+
+private:
+    using edge_t = std::tuple<node_t, node_t, weight_t>;
+    std::vector<edge_t> m_edges;
+
+};
@@ -3,7 +3,6 @@
 #include <algorithm>
 #include <fstream>
 #include <iostream>
-#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -11,7 +10,7 @@
 #include "types.hpp"
 #include "Utils.hpp"
 
-using edges_t = std::vector<std::pair<int_t, real_t>>;
+using edges_t = std::vector<std::pair<node_t, weight_t>>;
 using edges_itr_t = typename edges_t::iterator;
 using edges_const_itr_t = typename edges_t::const_iterator;
 
@@ -38,6 +37,7 @@ public:
 
     void add_edge(int_t v, int_t w, real_t weight) {
         if (v == w) return;
+        Utils::check_weight(weight);
         auto it = find_edge(v, w);
         if (it == end(v)) {
             // New edge.
@@ -90,26 +90,6 @@ public:
     bool one_based() const { return m_one_based; }
     bool two_sided() const { return m_two_sided; }
 
-    // Print details about the graph.
-    void print_details() const {
-        int_t n_nodes = 0, n_edges = 0, max_degree = 0;
-        for (std::size_t i = 0; i < size(); ++i) {
-            auto sz = degree(i);
-            if (two_sided()) {
-                sz += degree(i + 1);
-                if (sz >= 2) sz -= 2; // Remove "self-edge" from these calculations.
-                ++i;
-            }
-            n_nodes += sz > 0;
-            n_edges += sz;
-            max_degree = std::max(max_degree, sz);
-        }
-        std::string out_str = "Graph has " +  Utils::neat_number_str(n_nodes) + " connected" + (two_sided() ? " (half) " : " ") + "nodes and "
-                            + Utils::neat_number_str(n_edges / 2) + " edges. Avg and max degree are " 
-                            + Utils::neat_decimal_str(n_edges, n_nodes) + " and " + std::to_string(max_degree) + ".";
-        std::cout << out_str << std::endl;
-    }
-
     // Accessors and iterators.
     edges_t& operator[](std::size_t idx) { return m_adj[idx]; }
     const edges_t& operator[](std::size_t idx) const { return m_adj[idx]; }
@@ -137,66 +117,11 @@ public:
         return *this;
     }
 
-    // Compute the shortest distance between a source and a target.
-    real_t distance(int_t source, int_t target, real_t max_distance = REAL_T_MAX) const {
-        return distance(std::vector<std::pair<int_t, real_t>>{{source, 0.0}}, std::vector<int_t>{target}, max_distance).front();
-    }
-
-    // Compute shortest distance between source(s) and targets.
-    std::vector<real_t> distance(
-        const std::vector<std::pair<int_t, real_t>>& sources,
-        const std::vector<int_t>& targets,
-        real_t max_distance = REAL_T_MAX) const
-    {
-        std::vector<real_t> dist(size(), max_distance);
-
-        std::vector<bool> is_target(size());
-        for (auto w : targets) is_target[w] = true;
-        int_t targets_left = targets.size();
-
-        std::set<std::pair<real_t, int_t>> queue; // (distance, node) pairs.
-        for (auto s : sources) {
-            int_t v;
-            real_t initial_distance;
-            std::tie(v, initial_distance) = s;
-            dist[v] = initial_distance;
-            queue.emplace(initial_distance, v);
-        }
-
-        // Start search.
-        while (!queue.empty()) {
-            auto v = queue.begin()->second;
-            queue.erase(queue.begin());
-            if (is_target[v]) {
-                --targets_left;
-                is_target[v] = false;
-                if (two_sided()) {
-                    --targets_left;
-                    is_target[other_side(v)] = false;
-                }
-                if (targets_left == 0) break; // Calculated distances for all targets.
-            }            
-            for (auto vw : (*this)[v]) {
-                int_t w;
-                real_t weight;
-                std::tie(w, weight) = vw;
-                if (dist[v] + weight < dist[w]) {
-                    queue.erase({dist[w], w});
-                    dist[w] = dist[v] + weight;
-                    queue.insert({dist[w], w});
-                }
-            }
-        }
-        std::vector<real_t> target_dist;
-        for (auto target : targets) target_dist.push_back(dist[target]);
-        return target_dist;
-    }
-
 private:
     std::vector<edges_t> m_adj;
 
     // Filled if graph nodes are two-sided.
-    std::vector<real_t> m_self_edge_weights;
+    std::vector<weight_t> m_self_edge_weights;
 
     bool m_one_based;
     bool m_two_sided;
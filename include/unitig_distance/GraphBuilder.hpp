@@ -1,12 +1,18 @@
 #pragma once
 
-#include <fstream>
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
 #include <string>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 
+#include "BinaryIO.hpp"
+#include "CsrGraph.hpp"
+#include "EdgeList.hpp"
 #include "Graph.hpp"
+#include "LineReader.hpp"
 #include "ProgramOptions.hpp"
 #include "types.hpp"
 #include "Utils.hpp"
@@ -15,28 +21,43 @@ class GraphBuilder {
 public:
     static Graph build_ordinary_graph(const std::string& edges_filename, bool one_based = false) {
         Graph graph(one_based);
-        std::vector<std::tuple<int_t, int_t, real_t>> edges;
-        std::ifstream ifs(edges_filename);
-        int_t max_v = 0;
-        for (std::string line; std::getline(ifs, line); ) {
-            auto fields = Utils::get_fields(line);
-            if (fields.size() < 2) {
-                std::cerr << "Error: Wrong number of fields in graph edges file: " << edges_filename << std::endl;
-                return Graph();
+        ChunkedLineReader file(edges_filename, ProgramOptions::n_threads);
+        std::vector<EdgeList> chunk_edges(file.n_chunks());
+        std::vector<int_t> chunk_max_v(file.n_chunks(), 0);
+        bool ok = file.parse([&edges_filename, one_based, &chunk_edges, &chunk_max_v](std::size_t chunk_idx, LineReader& reader) {
+            auto& edges = chunk_edges[chunk_idx];
+            auto& max_v = chunk_max_v[chunk_idx];
+            while (reader.next_line()) {
+                const auto& fields = reader.fields();
+                if (fields.size() < 2) {
+                    std::cerr << "Error: Wrong number of fields in graph edges file: " << edges_filename << std::endl;
+                    return false;
+                }
+                int_t v, w;
+                if (!LineReader::to_int(fields[0], v) || !LineReader::to_int(fields[1], w)) {
+                    print_parse_error(edges_filename, reader);
+                    return false;
+                }
+                v -= one_based;
+                w -= one_based;
+                if (!Utils::valid_node(v) || !Utils::valid_node(w)) {
+                    print_node_range_error(edges_filename, reader);
+                    return false;
+                }
+                real_t weight;
+                if (fields.size() < 3 || !LineReader::to_real(fields[2], weight)) weight = 1.0;
+                edges.add_edge(v, w, weight);
+                max_v = std::max(max_v, std::max(v, w));
             }
-            int_t v = std::stoll(fields[0]) - one_based;
-            int_t w = std::stoll(fields[1]) - one_based;
-            real_t weight = fields.size() >= 3 && Utils::is_numeric(fields[2]) ? std::stod(fields[2]) : 1.0;
-            edges.emplace_back(v, w, weight);
-            max_v = std::max(max_v, std::max(v, w));
-        }
-        graph.resize(max_v + 1);
-        for (const auto& edge : edges) {
-            int_t v, w;
-            real_t weight;
-            std::tie(v, w, weight) = edge;
-            graph.add_edge(v, w, weight);
-        }
+            return true;
+        });
+        if (!ok) return Graph();
+
+        EdgeList edges;
+        for (const auto& chunk : chunk_edges) edges.append(chunk);
+        Utils::clear(chunk_edges);
+        graph.resize(*std::max_element(chunk_max_v.begin(), chunk_max_v.end()) + 1);
+        edges.build(graph, ProgramOptions::n_threads);
         return graph;
     }
 
@@ -44,80 +65,258 @@ public:
        This graph stores two nodes for each unitig: one for its left side and one for its right side, considered from the canonical form. */
     static Graph build_cdbg(const std::string& unitigs_filename, const std::string& edges_filename, int_t kmer_length, bool one_based = false) {
         Graph graph(one_based, true);
-        std::ifstream ifs_unitigs(unitigs_filename);
-        for (std::string line; std::getline(ifs_unitigs, line); ) {
-            auto fields = Utils::get_fields(line);
-            if (fields.size() < 2) {
-                std::cerr << "Error: Wrong number of fields in compacted de Bruijn graph unitigs file: " << unitigs_filename << std::endl;
-                return Graph();
+        ChunkedLineReader unitigs_file(unitigs_filename, ProgramOptions::n_threads);
+        std::vector<std::vector<real_t>> chunk_self_edge_weights(unitigs_file.n_chunks());
+        bool ok = unitigs_file.parse([&unitigs_filename, kmer_length, &chunk_self_edge_weights](std::size_t chunk_idx, LineReader& reader) {
+            while (reader.next_line()) {
+                const auto& fields = reader.fields();
+                if (fields.size() < 2) {
+                    std::cerr << "Error: Wrong number of fields in compacted de Bruijn graph unitigs file: " << unitigs_filename << std::endl;
+                    return false;
+                }
+                real_t self_edge_weight = (real_t) fields[1].size() - kmer_length;
+                if (self_edge_weight < 0.0) {
+                    std::cerr << "self_edge_weight = " << self_edge_weight << " < 0.0 -- wrong k-mer length?" << std::endl;
+                    return false;
+                }
+                chunk_self_edge_weights[chunk_idx].push_back(self_edge_weight);
             }
-            real_t self_edge_weight = (real_t) fields[1].size() - kmer_length;
-            if (self_edge_weight < 0.0) {
-                std::cerr << "self_edge_weight = " << self_edge_weight << " < 0.0 -- wrong k-mer length?" << std::endl;
+            return true;
+        });
+        if (!ok) return Graph();
+        std::size_t n_unitigs = 0;
+        for (const auto& chunk : chunk_self_edge_weights) n_unitigs += chunk.size();
+        if (n_unitigs > 0 && !Utils::valid_unitig(n_unitigs - 1)) {
+            print_too_many_unitigs_error(unitigs_filename);
+            return Graph();
+        }
+        for (const auto& chunk : chunk_self_edge_weights) {
+            for (auto self_edge_weight : chunk) graph.add_two_sided_node(self_edge_weight);
+        }
+
+        ChunkedLineReader edges_file(edges_filename, ProgramOptions::n_threads);
+        std::vector<EdgeList> chunk_edges(edges_file.n_chunks());
+        ok = edges_file.parse([&edges_filename, one_based, &chunk_edges](std::size_t chunk_idx, LineReader& reader) {
+            while (reader.next_line()) {
+                const auto& fields = reader.fields();
+                if (fields.size() < 3) {
+                    std::cerr << "Error: Wrong number of fields in compacted de Bruijn graph edges file:" << edges_filename << std::endl;
+                    return false;
+                }
+                int_t v, w;
+                bool good_overlap;
+                if (!parse_cdbg_edge(fields, one_based, v, w, good_overlap)) {
+                    print_parse_error(edges_filename, reader);
+                    return false;
+                }
+                if (!Utils::valid_node(v) || !Utils::valid_node(w)) {
+                    print_node_range_error(edges_filename, reader);
+                    return false;
+                }
+                if (!good_overlap) continue; // Non-overlapping edges ignored.
+                chunk_edges[chunk_idx].add_edge(v, w, 1.0); // Weight 1.0 by definition.
+            }
+            return true;
+        });
+        if (!ok) return Graph();
+
+        EdgeList edges;
+        for (const auto& chunk : chunk_edges) edges.append(chunk);
+        Utils::clear(chunk_edges);
+        edges.build(graph, ProgramOptions::n_threads);
+        return graph;
+    }
+
+    /*
+        Construct a compacted de Bruijn graph from a GFA1 file in a single pass. Unitigs are numbered in the order of
+        their S lines, and their lengths are taken from the LN tag or the sequence, which isn't stored. L lines with
+        a 0M overlap are skipped like non-overlapping edges. If kmer_length isn't set, it's deduced from the overlaps.
+    */
+    static Graph build_gfa(const std::string& gfa_filename, int_t& kmer_length, bool one_based = false) {
+        Graph graph(one_based, true);
+        std::unordered_map<std::string, int_t> segment_ids;
+        std::vector<int_t> segment_lengths;
+        EdgeList edges;
+        std::vector<std::tuple<std::string, std::string, std::string>> unresolved_links; // Links read before their segments.
+        int_t overlap_kmer_length = 0;
+
+        LineReader reader(gfa_filename);
+        while (reader.next_line()) {
+            if (reader.line().empty()) continue;
+            char record_type = reader.line()[0];
+            if (record_type != 'S' && record_type != 'L') continue; // Other records aren't needed.
+            const auto& fields = reader.fields('\t');
+            if (record_type == 'S') {
+                int_t length = -1;
+                if (fields.size() < 3) {
+                    print_parse_error(gfa_filename, reader);
+                    return Graph();
+                }
+                for (std::size_t i = 3; i < fields.size(); ++i) {
+                    if (fields[i].size() > 5 && std::equal(fields[i].begin(), fields[i].begin() + 5, "LN:i:")) {
+                        if (!LineReader::to_int(StringView(fields[i].data() + 5, fields[i].size() - 5), length)) length = -1;
+                    }
+                }
+                if (length < 0 && !(fields[2].size() == 1 && fields[2][0] == '*')) length = fields[2].size();
+                if (length < 0 || !segment_ids.emplace(fields[1].str(), segment_lengths.size()).second) {
+                    print_parse_error(gfa_filename, reader);
+                    return Graph();
+                }
+                segment_lengths.push_back(length);
+            } else {
+                int_t overlap;
+                if (fields.size() < 6 || fields[2].size() != 1 || fields[4].size() != 1 || !parse_gfa_overlap(fields[5], overlap)) {
+                    print_parse_error(gfa_filename, reader);
+                    return Graph();
+                }
+                if (overlap == 0) continue; // Non-overlapping edges ignored.
+                if (overlap > 0 && overlap_kmer_length == 0) overlap_kmer_length = overlap + 1;
+                auto v_it = segment_ids.find(fields[1].str());
+                auto w_it = segment_ids.find(fields[3].str());
+                if (v_it == segment_ids.end() || w_it == segment_ids.end()) {
+                    unresolved_links.emplace_back(fields[1].str(), fields[3].str(), std::string{fields[2][0], fields[4][0]});
+                    continue;
+                }
+                add_gfa_link(edges, v_it->second, fields[2][0], w_it->second, fields[4][0]);
+            }
+        }
+        if (!reader.good()) return Graph();
+
+        for (const auto& link : unresolved_links) {
+            auto v_it = segment_ids.find(std::get<0>(link));
+            auto w_it = segment_ids.find(std::get<1>(link));
+            if (v_it == segment_ids.end() || w_it == segment_ids.end()) {
+                std::cerr << "Error: Link to a missing segment in GFA file: " << gfa_filename << std::endl;
                 return Graph();
             }
-            graph.add_two_sided_node(self_edge_weight);
+            add_gfa_link(edges, v_it->second, std::get<2>(link)[0], w_it->second, std::get<2>(link)[1]);
         }
 
-        std::ifstream ifs_edges(edges_filename);
-        for (std::string line; std::getline(ifs_edges, line); ) {
-            auto fields = Utils::get_fields(line);
-            if (fields.size() < 3) {
-                std::cerr << "Error: Wrong number of fields in compacted de Bruijn graph edges file:" << edges_filename << std::endl;
+        if (kmer_length <= 0) kmer_length = overlap_kmer_length;
+        if (kmer_length <= 0) {
+            std::cerr << "Error: Could not deduce k-mer length from the GFA file, please set it with -k [ --k-mer-length ] arg." << std::endl;
+            return Graph();
+        }
+        if (!segment_lengths.empty() && !Utils::valid_unitig(segment_lengths.size() - 1)) {
+            print_too_many_unitigs_error(gfa_filename);
+            return Graph();
+        }
+        for (auto length : segment_lengths) {
+            real_t self_edge_weight = (real_t) length - kmer_length;
+            if (self_edge_weight < 0.0) {
+                std::cerr << "self_edge_weight = " << self_edge_weight << " < 0.0 -- wrong k-mer length?" << std::endl;
                 return Graph();
             }
-            bool good_overlap = fields.size() < 4 || std::stoll(fields[3]) != 0;
-            if (!good_overlap) continue; // Non-overlapping edges ignored.
-            std::string edge_type = fields[2];
-            int_t v = 2 * (std::stoll(fields[0]) - one_based) + (edge_type[0] == 'F'); // F* edge means link comes from v's right side.
-            int_t w = 2 * (std::stoll(fields[1]) - one_based) + (edge_type[1] == 'R'); // *R edge means link goes to w's right side.
-            graph.add_edge(v, w, 1.0); // Weight 1.0 by definition.
+            graph.add_two_sided_node(self_edge_weight);
         }
+        edges.build(graph, ProgramOptions::n_threads);
         return graph;
     }
 
-    // Construct an edge-induced subgraph from the compacted de Bruijn graph. Will be used to construct a single genome graph.
-    static Graph build_cdbg_subgraph(const Graph& cdbg, const std::string& edges_filename) {
+    /*
+        Read the edges of a single genome graph, which is an edge-induced subgraph of the compacted de Bruijn graph.
+        Edges without a good overlap and self-loops are left out. n_nodes is set to the number of nodes spanned by the edges.
+    */
+    static bool read_cdbg_subgraph_edges(const CsrGraph& cdbg, const std::string& edges_filename, std::vector<std::pair<int_t, int_t>>& edges, int_t& n_nodes) {
         if (!cdbg.two_sided()) {
-            std::cerr << "Error: build_cdbg_subgraph called with non-two-sided graph." << std::endl;
-            return Graph();
+            std::cerr << "Error: read_cdbg_subgraph_edges called with non-two-sided graph." << std::endl;
+            return false;
         }
-        Graph graph(cdbg.one_based(), false);
-        std::vector<std::pair<int_t, int_t>> edges;
-        std::ifstream ifs_edges(edges_filename);
+        edges.clear();
+        LineReader reader(edges_filename);
         int_t max_v = 0;
-        for (std::string line; std::getline(ifs_edges, line); ) {
-            auto fields = Utils::get_fields(line);
+        while (reader.next_line()) {
+            const auto& fields = reader.fields();
             if (fields.size() < 3) {
                 std::cout << "Error: Wrong number of fields in single genome graph edges file: " << edges_filename << std::endl;
-                return Graph();
+                return false;
+            }
+            int_t v, w;
+            bool good_overlap;
+            if (!parse_cdbg_edge(fields, cdbg.one_based(), v, w, good_overlap)) {
+                print_parse_error(edges_filename, reader);
+                return false;
             }
-            bool good_overlap = fields.size() < 4 || std::stoll(fields[3]) != 0;
             if (!good_overlap) continue; // Non-overlapping edges ignored.
-            std::string edge_type = fields[2];
-            int_t v = 2 * (std::stoll(fields[0]) - graph.one_based()) + (edge_type[0] == 'F'); // F* edge means link comes from v's right side.
-            int_t w = 2 * (std::stoll(fields[1]) - graph.one_based()) + (edge_type[1] == 'R'); // *R edge means link goes to w's right side.
-            edges.emplace_back(v, w);
+            if (!Utils::valid_node(v) || !Utils::valid_node(w) || !cdbg.contains(v) || !cdbg.contains(w)) {
+                std::cerr << "Error: Edge on line " << reader.line_number() << " \"" << reader.line().str() << "\" in file " << edges_filename
+                          << " has a node that is not in the compacted de Bruijn graph" << std::endl;
+                return false;
+            }
             max_v = std::max(max_v, std::max(v, w));
+            if (v != w) edges.emplace_back(v, w); // Self-loops are ignored like in Graph::add_edge.
         }
-        graph.resize((max_v | 1) + 1);
+        if (!reader.good()) return false;
+        n_nodes = (max_v | 1) + 1;
+        return true;
+    }
 
-        for (const auto& edge : edges) {
-            int_t v, w;
-            std::tie(v, w) = edge;
-            // Get self-edges from the original graph.
-            if (graph.degree(v) == 0) graph.add_edge(v, graph.other_side(v), cdbg.get_self_edge_weight(v));
-            if (graph.degree(w) == 0) graph.add_edge(w, graph.other_side(w), cdbg.get_self_edge_weight(w));
-            graph.add_edge(v, w, 1.0); // Weight 1.0 by definition.
-        }
-        return graph;
+    // Fingerprint of the input files and options the main graph is constructed from, used to validate a saved graph. Options are hashed as given on the command line.
+    static uint64_t input_fingerprint() {
+        uint64_t hash = BinaryIO::file_fingerprint(ProgramOptions::main_graph_filename());
+        if (ProgramOptions::has_operating_mode(OperatingMode::CDBG) && ProgramOptions::gfa_filename.empty()) hash = BinaryIO::file_fingerprint(ProgramOptions::unitigs_filename, hash);
+        int64_t options[] = { ProgramOptions::k, ProgramOptions::graphs_one_based, ProgramOptions::has_operating_mode(OperatingMode::CDBG) };
+        return BinaryIO::hash_bytes(reinterpret_cast<const unsigned char*>(options), sizeof(options), hash);
     }
 
     static Graph build_correct_graph() {
         if (ProgramOptions::has_operating_mode(OperatingMode::GENERAL)) return build_ordinary_graph(ProgramOptions::edges_filename, ProgramOptions::graphs_one_based);
+        if (!ProgramOptions::gfa_filename.empty()) {
+            int_t kmer_length = ProgramOptions::k; // The deduced k-mer length isn't written back, so that input_fingerprint() doesn't change.
+            return build_gfa(ProgramOptions::gfa_filename, kmer_length, ProgramOptions::graphs_one_based);
+        }
         if (ProgramOptions::has_operating_mode(OperatingMode::CDBG)) return build_cdbg(ProgramOptions::unitigs_filename, ProgramOptions::edges_filename, ProgramOptions::k, ProgramOptions::graphs_one_based);
         std::cout << "Error: Program logic error." << std::endl;
         return Graph();
     }
 
+private:
+    /*
+        Parse a compacted de Bruijn graph edge "v w type [overlap]" into the sides it links. Sides of unitigs whose indices
+        don't fit in node_t are set to -1, which the caller rejects with Utils::valid_node.
+    */
+    static bool parse_cdbg_edge(const std::vector<StringView>& fields, bool one_based, int_t& v, int_t& w, bool& good_overlap) {
+        int_t overlap = 1;
+        if (!LineReader::to_int(fields[0], v) || !LineReader::to_int(fields[1], w) || fields[2].size() < 2) return false;
+        if (fields.size() >= 4 && !LineReader::to_int(fields[3], overlap)) return false;
+        good_overlap = overlap != 0;
+        if (!Utils::valid_unitig(v - one_based) || !Utils::valid_unitig(w - one_based)) {
+            v = w = -1;
+            return true;
+        }
+        StringView edge_type = fields[2];
+        v = 2 * (v - one_based) + (edge_type[0] == 'F'); // F* edge means link comes from v's right side.
+        w = 2 * (w - one_based) + (edge_type[1] == 'R'); // *R edge means link goes to w's right side.
+        return true;
+    }
+
+    // Link from v's orientation side to w's, oriented like the F and R edge types.
+    static void add_gfa_link(EdgeList& edges, int_t v, char v_orientation, int_t w, char w_orientation) {
+        v = 2 * v + (v_orientation == '+'); // + means link comes from v's right side.
+        w = 2 * w + (w_orientation == '-'); // - means link goes to w's right side.
+        edges.add_edge(v, w, 1.0); // Weight 1.0 by definition.
+    }
+
+    // Overlap of a link from a CIGAR string such as "30M", or -1 if the overlap is unspecified ("*").
+    static bool parse_gfa_overlap(StringView cigar, int_t& overlap) {
+        if (cigar.size() == 1 && cigar[0] == '*') {
+            overlap = -1;
+            return true;
+        }
+        return cigar.size() >= 2 && cigar[cigar.size() - 1] == 'M' && LineReader::to_int(StringView(cigar.data(), cigar.size() - 1), overlap);
+    }
+
+    static void print_parse_error(const std::string& filename, const LineReader& reader) {
+        std::cerr << "Error: Could not parse line " << reader.line_number() << " \"" << reader.line().str() << "\" in file " << filename << std::endl;
+    }
+
+    static void print_node_range_error(const std::string& filename, const LineReader& reader) {
+        std::cerr << "Error: Node index out of range on line " << reader.line_number() << " \"" << reader.line().str() << "\" in file " << filename
+                  << ", node indices must be below " << NODE_T_MAX << " (" << NODE_T_MAX / 2 << " for unitigs) in this build." << std::endl;
+    }
+
+    static void print_too_many_unitigs_error(const std::string& filename) {
+        std::cerr << "Error: Too many unitigs in file " << filename << ", at most " << NODE_T_MAX / 2 << " are supported in this build." << std::endl;
+    }
+
 };
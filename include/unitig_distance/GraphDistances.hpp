@@ -1,77 +1,272 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <numeric>
 #include <set>
-#include <thread>
 #include <utility>
 #include <vector>
 
+#include "Components.hpp"
+#include "ContractionHierarchy.hpp"
+#include "CsrGraph.hpp"
 #include "Distance.hpp"
 #include "DistanceVector.hpp"
-#include "Graph.hpp"
+#include "HubLabels.hpp"
+#include "Landmarks.hpp"
 #include "PrintUtils.hpp"
 #include "ProgramOptions.hpp"
 #include "SearchJobs.hpp"
+#include "SearchWorkspace.hpp"
+#include "SingleGenomeGraph.hpp"
+#include "SingleGenomeGraphDistances.hpp"
+#include "ThreadPool.hpp"
 #include "Timer.hpp"
 #include "types.hpp"
 
 class GraphDistances {
 public:
     GraphDistances() = delete;
-    GraphDistances(const Graph& graph, const Timer& timer)
+    GraphDistances(const CsrGraph& graph, const Timer& timer)
     : m_graph(graph),
-      m_timer(timer)
+      m_timer(timer),
+      m_landmarks(nullptr),
+      m_ch(nullptr),
+      m_hub_labels(nullptr),
+      m_compressed_graph(nullptr),
+      m_components(nullptr)
     { }
 
+    // Use landmark lower bounds to skip searches beyond max distance and to guide searches with few targets.
+    void use_landmarks(const Landmarks& landmarks) { m_landmarks = &landmarks; }
+
+    // Answer queries with upward searches in the contraction hierarchy instead of searching the graph.
+    void use_contraction_hierarchy(const ContractionHierarchy& ch) { m_ch = &ch; }
+
+    // Answer queries by merging hub labels, no searches are needed.
+    void use_hub_labels(const HubLabels& hub_labels) { m_hub_labels = &hub_labels; }
+
+    // Search the graph with its paths compressed, nodes inside paths are resolved through path offsets.
+    void use_compressed_graph(const SingleGenomeGraph& compressed_graph) { m_compressed_graph = &compressed_graph; }
+
+    // Drop targets in other components than the source from the searches.
+    void use_components(const Components& components) { m_components = &components; }
+
     // Calculate distances for general graphs and compacted de Bruijn graphs.
+    DistanceVector solve(const SearchJobs& search_jobs) {
+        // Dispatch on sidedness once, so that the search kernels are specialised for the operating mode.
+        if (m_graph.two_sided()) return solve<true>(search_jobs);
+        return solve<false>(search_jobs);
+    }
+
+private:
+    const CsrGraph& m_graph;
+    const Timer& m_timer;
+
+    const Landmarks* m_landmarks;
+    const ContractionHierarchy* m_ch;
+    const HubLabels* m_hub_labels;
+    const SingleGenomeGraph* m_compressed_graph;
+    const Components* m_components;
+
+    bool m_verbose;
+
+    static constexpr std::size_t PROGRESS_INTERVAL = 10000; // Jobs between progress reports.
+
+    template <bool TwoSided>
     DistanceVector solve(const SearchJobs& search_jobs) {
         DistanceVector res(search_jobs.n_queries(), REAL_T_MAX);
+        std::vector<SearchWorkspace> workspaces(ProgramOptions::n_threads);
+        std::unique_ptr<SingleGenomeGraphDistances> compressed_solver;
+        if (m_compressed_graph) compressed_solver.reset(new SingleGenomeGraphDistances(*m_compressed_graph));
 
-        auto calculate_distance_block = [this, &search_jobs, &res](std::size_t thr, std::size_t block_start, std::size_t block_end) {
-            bool two_sided = m_graph.two_sided();
-            for (std::size_t i = thr + block_start; i < block_end; i += ProgramOptions::n_threads) {
-                const auto& job = search_jobs[i];
+        // Collect the targets of a job that need to be searched for.
+        auto search_targets = [this, &res](const SearchJob& job, int_t v) {
+            auto max_distance = ProgramOptions::max_distance;
+            std::vector<std::size_t> w_indices;
+            for (std::size_t w_idx = 0; w_idx < job.size(); ++w_idx) {
+                auto w = m_graph.reordered_node(job.ws()[w_idx]);
+                if (!contains_node<TwoSided>(w)) continue;
+                if (m_components && !connected<TwoSided>(v, w)) {
+                    res[job.original_index(w_idx)] = max_distance; // Different components, no need to search.
+                    continue;
+                }
+                if (m_landmarks && lower_bound<TwoSided>(v, w) >= max_distance) {
+                    res[job.original_index(w_idx)] = max_distance; // Can't be within max distance, no need to search.
+                    continue;
+                }
+                w_indices.push_back(w_idx);
+            }
+            return w_indices;
+        };
+
+        auto solve_job = [this, &res, &compressed_solver, &search_targets](const SearchJob& job, SearchWorkspace& workspace) {
+            auto max_distance = ProgramOptions::max_distance;
 
-                auto v = job.v();
-                if ((two_sided && !m_graph.contains(m_graph.left_node(v))) || !m_graph.contains(v)) continue;
+            auto v = m_graph.reordered_node(job.v()); // Search jobs use original node indices.
+            if (!contains_node<TwoSided>(v)) return;
 
-                auto sources = get_sources(v);
-                auto targets = get_targets(job.ws());
-                auto target_dist = m_graph.distance(sources, targets, ProgramOptions::max_distance);
+            if (m_hub_labels) {
+                for (std::size_t w_idx = 0; w_idx < job.size(); ++w_idx) {
+                    auto w = m_graph.reordered_node(job.ws()[w_idx]);
+                    if (contains_node<TwoSided>(w)) res[job.original_index(w_idx)] = std::min(hub_labels_distance<TwoSided>(v, w), max_distance);
+                }
+                return;
+            }
 
+            if (compressed_solver) {
+                auto job_dist = compressed_solver->job_distances(job, workspace);
                 for (std::size_t w_idx = 0; w_idx < job.size(); ++w_idx) {
-                    auto original_idx = job.original_index(w_idx);
-                    if (two_sided) {
-                        // target_dist contains w's both sides for each w_idx.
-                        res[original_idx] = std::min(target_dist[w_idx * 2], target_dist[w_idx * 2 + 1]);
+                    if (contains_node<TwoSided>(job.ws()[w_idx])) res[job.original_index(w_idx)] = job_dist[w_idx];
+                }
+                return;
+            }
+
+            auto w_indices = search_targets(job, v);
+            if (w_indices.empty()) return;
+
+            auto sources = get_sources<TwoSided>(v);
+
+            if (m_ch) {
+                std::vector<std::vector<std::pair<int_t, real_t>>> target_sources;
+                for (auto w_idx : w_indices) target_sources.push_back(get_sources<TwoSided>(m_graph.reordered_node(job.ws()[w_idx])));
+                auto target_dist = m_ch->distances(sources, target_sources, max_distance, workspace);
+                for (std::size_t j = 0; j < w_indices.size(); ++j) res[job.original_index(w_indices[j])] = target_dist[j];
+                return;
+            }
+
+            if (w_indices.size() <= CsrGraph::BIDIRECTIONAL_MAX_TARGETS) {
+                for (auto w_idx : w_indices) {
+                    auto w = m_graph.reordered_node(job.ws()[w_idx]);
+                    if (m_landmarks) {
+                        // Goal-directed search towards w's sides.
+                        auto targets = get_targets<TwoSided>({w});
+                        auto heuristic = [this, &targets](int_t x) {
+                            real_t bound = REAL_T_MAX;
+                            for (auto target : targets) bound = std::min(bound, m_landmarks->lower_bound(x, target));
+                            return bound;
+                        };
+                        auto target_dist = m_graph.astar_distance<TwoSided>(sources, targets, max_distance, workspace, heuristic);
+                        res[job.original_index(w_idx)] = *std::min_element(target_dist.begin(), target_dist.end());
                     } else {
-                        res[original_idx] = target_dist[w_idx];
+                        // Search from both ends, w's sides act as the backward sources.
+                        res[job.original_index(w_idx)] = m_graph.bidirectional_distance(sources, get_sources<TwoSided>(w), max_distance, workspace);
                     }
                 }
+                return;
+            }
+
+            std::vector<int_t> ws;
+            for (auto w_idx : w_indices) ws.push_back(m_graph.reordered_node(job.ws()[w_idx]));
+            auto targets = get_targets<TwoSided>(ws);
+            auto target_dist = m_graph.distance<TwoSided>(sources, targets, max_distance, workspace);
+
+            for (std::size_t j = 0; j < w_indices.size(); ++j) {
+                auto original_idx = job.original_index(w_indices[j]);
+                if (TwoSided) {
+                    // target_dist contains w's both sides for each w.
+                    res[original_idx] = std::min(target_dist[j * 2], target_dist[j * 2 + 1]);
+                } else {
+                    res[original_idx] = target_dist[j];
+                }
             }
         };
 
-        for (std::size_t block_start = 0; block_start < search_jobs.size(); block_start += 10000) {
-            Timer t;
-            std::size_t block_end = std::min(block_start + 10000, search_jobs.size());
-            std::vector<std::thread> threads;
-            for (int_t thr = 0; thr < ProgramOptions::n_threads; ++thr) threads.emplace_back(calculate_distance_block, thr, block_start, block_end);
-            for (auto& thr : threads) thr.join();
-            if (ProgramOptions::verbose) PrintUtils::print_tbss_tsm(m_timer, "Calculated distances for block", block_start + 1, '-', block_end, '/', search_jobs.size());
-        }
+        // Jobs are handed out from an atomic cursor, largest jobs first, so that threads finish at the same time.
+        std::vector<std::size_t> order(search_jobs.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&search_jobs](std::size_t a, std::size_t b) { return search_jobs[a].size() > search_jobs[b].size(); });
+
+        // Consecutive jobs in a one-sided graph with unit weights are solved together with one multi-source breadth-first search.
+        auto solve_batch = [this, &res, &search_jobs, &order, &search_targets](std::size_t first, std::size_t last, SearchWorkspace& workspace) {
+            std::vector<const SearchJob*> jobs;
+            std::vector<std::vector<std::size_t>> w_indices;
+            std::vector<int_t> sources;
+            std::vector<std::vector<int_t>> targets;
+            for (std::size_t i = first; i < last; ++i) {
+                const auto& job = search_jobs[order[i]];
+                auto v = m_graph.reordered_node(job.v());
+                if (!contains_node<TwoSided>(v)) continue;
+                auto job_w_indices = search_targets(job, v);
+                if (job_w_indices.empty()) continue;
+                std::vector<int_t> ws;
+                for (auto w_idx : job_w_indices) ws.push_back(m_graph.reordered_node(job.ws()[w_idx]));
+                jobs.push_back(&job);
+                w_indices.push_back(std::move(job_w_indices));
+                sources.push_back(v);
+                targets.push_back(std::move(ws));
+            }
+            if (jobs.empty()) return;
+            auto target_dist = m_graph.multi_source_bfs(sources, targets, ProgramOptions::max_distance, workspace);
+            for (std::size_t b = 0; b < jobs.size(); ++b) {
+                for (std::size_t j = 0; j < w_indices[b].size(); ++j) res[jobs[b]->original_index(w_indices[b][j])] = target_dist[b][j];
+            }
+        };
+        bool batched = !TwoSided && m_graph.unit_weights() && !m_hub_labels && !m_ch && !compressed_solver;
+        std::size_t batch_size = batched ? CsrGraph::BFS_BATCH_SIZE : 1;
+        std::size_t n_batches = (search_jobs.size() + batch_size - 1) / batch_size;
+
+        std::atomic<std::size_t> next_batch(0), n_solved_jobs(0);
+        std::mutex print_mutex;
+        auto calculate_distances = [this, &search_jobs, &workspaces, &solve_job, &solve_batch, &order, batched, batch_size, n_batches, &next_batch, &n_solved_jobs, &print_mutex](std::size_t thr) {
+            auto& workspace = workspaces[thr];
+            for (std::size_t batch_idx = next_batch++; batch_idx < n_batches; batch_idx = next_batch++) {
+                std::size_t first = batch_idx * batch_size;
+                std::size_t last = std::min(first + batch_size, search_jobs.size());
+                if (batched) solve_batch(first, last, workspace);
+                else solve_job(search_jobs[order[first]], workspace);
+                auto n_solved = n_solved_jobs += last - first;
+                if (ProgramOptions::verbose && (n_solved / PROGRESS_INTERVAL != (n_solved - (last - first)) / PROGRESS_INTERVAL || n_solved == search_jobs.size())) {
+                    std::lock_guard<std::mutex> lock(print_mutex);
+                    PrintUtils::print_tbss_tsm(m_timer, "Calculated distances for", n_solved, '/', search_jobs.size(), "search jobs");
+                }
+            }
+        };
+
+        ThreadPool::instance().run(ProgramOptions::n_threads, calculate_distances);
 
         return res;
     }
 
-private:
-    const Graph& m_graph;
-    const Timer& m_timer;
+    template <bool TwoSided>
+    bool contains_node(int_t v) const { return (!TwoSided || m_graph.contains(m_graph.left_node(v))) && m_graph.contains(v); }
 
-    bool m_verbose;
-    
-    std::vector<std::pair<int_t, real_t>> get_sources(int_t v) {
+    // Sides of a two-sided node are always connected.
+    template <bool TwoSided>
+    bool connected(int_t v, int_t w) const {
+        if (!TwoSided) return m_components->connected(v, w);
+        return m_components->connected(m_graph.left_node(v), m_graph.left_node(w));
+    }
+
+    // Landmark lower bound for the distance between original nodes v and w.
+    template <bool TwoSided>
+    real_t lower_bound(int_t v, int_t w) const {
+        if (!TwoSided) return m_landmarks->lower_bound(v, w);
+        real_t bound = REAL_T_MAX;
+        for (auto v_side : {m_graph.left_node(v), m_graph.right_node(v)}) {
+            for (auto w_side : {m_graph.left_node(w), m_graph.right_node(w)}) bound = std::min(bound, m_landmarks->lower_bound(v_side, w_side));
+        }
+        return bound;
+    }
+
+    // Hub labels distance between original nodes v and w, taking the minimum over their sides.
+    template <bool TwoSided>
+    real_t hub_labels_distance(int_t v, int_t w) const {
+        if (!TwoSided) return m_hub_labels->distance(v, w);
+        real_t dist = REAL_T_MAX;
+        for (auto v_side : {m_graph.left_node(v), m_graph.right_node(v)}) {
+            for (auto w_side : {m_graph.left_node(w), m_graph.right_node(w)}) dist = std::min(dist, m_hub_labels->distance(v_side, w_side));
+        }
+        return dist;
+    }
+
+    template <bool TwoSided>
+    std::vector<std::pair<int_t, real_t>> get_sources(int_t v) const {
         std::vector<std::pair<int_t, real_t>> sources;
-        if (m_graph.two_sided()) {
+        if (TwoSided) {
             sources.emplace_back(m_graph.left_node(v), 0.0);
             sources.emplace_back(m_graph.right_node(v), 0.0);
         } else {
@@ -80,10 +275,11 @@ private:
         return sources;
     }
 
-    std::vector<int_t> get_targets(const std::vector<int_t>& ws) {
+    template <bool TwoSided>
+    std::vector<int_t> get_targets(const std::vector<int_t>& ws) const {
         std::vector<int_t> targets;
         for (auto w : ws) {
-            if (m_graph.two_sided()) {
+            if (TwoSided) {
                 targets.push_back(m_graph.left_node(w));
                 targets.push_back(m_graph.right_node(w));
             } else {
@@ -0,0 +1,152 @@
+/*
+    Exact 2-hop distance labels built with pruned landmark labeling (Akiba et al. 2013). Every node
+    stores a list of (hub, distance) pairs such that each shortest path passes through a hub shared
+    by the labels of both endpoints, so a distance is answered by merging two sorted lists without
+    searching the graph. The labels are built once with -hlb [ --build-hub-labels ] and written to a
+    binary file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <numeric>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "BinaryIO.hpp"
+#include "CsrGraph.hpp"
+#include "SearchWorkspace.hpp"
+#include "types.hpp"
+#include "Utils.hpp"
+
+class HubLabels {
+public:
+    HubLabels() : m_offsets(1, 0), m_hubs(), m_dist() { }
+
+    std::size_t size() const { return m_offsets.size() - 1; }
+
+    std::size_t n_label_entries() const { return m_hubs.size(); }
+
+    /*
+        Nodes are used as hubs in order of decreasing degree. A pruned search from each hub only labels
+        the nodes whose distance to the hub isn't already covered by the labels of earlier hubs.
+    */
+    static HubLabels build(const CsrGraph& graph) {
+        std::size_t sz = graph.size();
+        std::vector<int_t> order(sz);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&graph](int_t a, int_t b) { return graph.degree(a) > graph.degree(b); });
+
+        std::vector<std::vector<std::pair<int_t, real_t>>> labels(sz);
+        std::vector<real_t> hub_dist(sz, REAL_T_MAX); // Label of the current hub, indexed by hub rank.
+        SearchWorkspace workspace;
+        for (std::size_t rank = 0; rank < sz; ++rank) {
+            if (graph.integer_weights()) pruned_search(graph, order[rank], rank, labels, hub_dist, workspace, workspace.radix_heap());
+            else pruned_search(graph, order[rank], rank, labels, hub_dist, workspace, workspace.binary_heap());
+        }
+
+        HubLabels hl;
+        for (auto& label : labels) {
+            for (const auto& entry : label) {
+                hl.m_hubs.push_back(entry.first);
+                hl.m_dist.push_back(entry.second);
+            }
+            hl.m_offsets.push_back(hl.m_hubs.size());
+            Utils::clear(label);
+        }
+        return hl;
+    }
+
+    // Distance between nodes v and w, REAL_T_MAX if they are disconnected.
+    real_t distance(int_t v, int_t w) const {
+        int_t i = m_offsets[v], i_end = m_offsets[v + 1];
+        int_t j = m_offsets[w], j_end = m_offsets[w + 1];
+        real_t dist = REAL_T_MAX;
+        while (i < i_end && j < j_end) {
+            if (m_hubs[i] < m_hubs[j]) {
+                ++i;
+            } else if (m_hubs[i] > m_hubs[j]) {
+                ++j;
+            } else {
+                dist = std::min(dist, m_dist[i++] + m_dist[j++]);
+            }
+        }
+        return dist;
+    }
+
+    bool save(const CsrGraph& graph, const std::string& filename) const {
+        std::ofstream ofs(filename, std::ios::binary);
+        if (!ofs) return false;
+        BinaryIO::write_header(ofs, MAGIC, VERSION, graph.fingerprint());
+        BinaryIO::write_vector(ofs, m_offsets);
+        BinaryIO::write_vector(ofs, m_hubs);
+        BinaryIO::write_vector(ofs, m_dist);
+        return (bool) ofs;
+    }
+
+    // Load the labels from file. Fails if the labels were built from a different graph.
+    bool load(const CsrGraph& graph, const std::string& filename) {
+        std::ifstream ifs(filename, std::ios::binary);
+        if (!ifs || !BinaryIO::read_header(ifs, MAGIC, VERSION, graph.fingerprint())) return false;
+        if (!BinaryIO::read_vector(ifs, m_offsets) || !BinaryIO::read_vector(ifs, m_hubs) || !BinaryIO::read_vector(ifs, m_dist)) return false;
+        return size() == graph.size();
+    }
+
+private:
+    static constexpr const char* MAGIC = "UDHL";
+    static constexpr uint32_t VERSION = 2;
+
+    // Labels in CSR format, each label sorted by hub rank.
+    std::vector<int_t> m_offsets;
+    std::vector<node_t> m_hubs;
+    std::vector<real_t> m_dist;
+
+    template <typename Queue>
+    static void pruned_search(
+        const CsrGraph& graph,
+        int_t hub,
+        int_t rank,
+        std::vector<std::vector<std::pair<int_t, real_t>>>& labels,
+        std::vector<real_t>& hub_dist,
+        SearchWorkspace& workspace,
+        Queue& queue)
+    {
+        for (const auto& entry : labels[hub]) hub_dist[entry.first] = entry.second;
+
+        workspace.reset(graph.size(), REAL_T_MAX);
+        workspace.set_dist(hub, 0.0);
+        queue.push(0.0, hub);
+        while (!queue.empty()) {
+            int_t v;
+            real_t v_dist;
+            std::tie(v_dist, v) = queue.pop();
+            if (v_dist > workspace.dist(v)) continue; // Stale queue entry.
+
+            // Prune if the labels of earlier hubs already give a path at least as short.
+            bool covered = false;
+            for (const auto& entry : labels[v]) {
+                if (hub_dist[entry.first] != REAL_T_MAX && hub_dist[entry.first] + entry.second <= v_dist) {
+                    covered = true;
+                    break;
+                }
+            }
+            if (covered) continue;
+
+            labels[v].emplace_back(rank, v_dist);
+            for (auto neighbor : graph[v]) {
+                int_t w = neighbor.first;
+                real_t w_dist = v_dist + neighbor.second;
+                if (w_dist < workspace.dist(w)) {
+                    workspace.set_dist(w, w_dist);
+                    queue.push(w_dist, w);
+                }
+            }
+        }
+
+        for (const auto& entry : labels[hub]) hub_dist[entry.first] = REAL_T_MAX;
+    }
+
+};
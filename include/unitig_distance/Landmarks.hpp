@@ -0,0 +1,113 @@
+/*
+    Landmark distance tables for goal-directed (ALT) searches. By the triangle inequality,
+    |d(L, v) - d(L, w)| is a lower bound for d(v, w) for every landmark L, which is used both as
+    the A* heuristic and for skipping queries that can't be within the maximum distance.
+    The tables are computed in parallel and saved next to the graph for reuse in later runs.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BinaryIO.hpp"
+#include "CsrGraph.hpp"
+#include "SearchWorkspace.hpp"
+#include "ThreadPool.hpp"
+#include "types.hpp"
+
+class Landmarks {
+public:
+    Landmarks() : m_n_landmarks(0) { }
+
+    std::size_t size() const { return m_n_landmarks; }
+
+    // Lower bound for the distance between nodes v and w. REAL_T_MAX if they are known to be disconnected.
+    real_t lower_bound(int_t v, int_t w) const {
+        const real_t* v_dist = m_dist.data() + v * m_n_landmarks;
+        const real_t* w_dist = m_dist.data() + w * m_n_landmarks;
+        real_t bound = 0.0;
+        for (std::size_t l = 0; l < m_n_landmarks; ++l) {
+            bool v_reached = v_dist[l] != REAL_T_MAX, w_reached = w_dist[l] != REAL_T_MAX;
+            if (v_reached != w_reached) return REAL_T_MAX; // Only one of the nodes is in the landmark's component.
+            if (v_reached) bound = std::max(bound, std::abs(v_dist[l] - w_dist[l]));
+        }
+        return bound;
+    }
+
+    // Load landmarks from file if it matches the graph, otherwise compute them and save to file.
+    static Landmarks load_or_compute(const CsrGraph& graph, std::size_t n_landmarks, const std::string& filename, int_t n_threads) {
+        Landmarks landmarks;
+        if (landmarks.load(graph, n_landmarks, filename)) return landmarks;
+        landmarks = compute(graph, n_landmarks, n_threads);
+        if (!landmarks.save(graph, filename)) std::cerr << "Warning: Couldn't save landmarks to " << filename << std::endl;
+        return landmarks;
+    }
+
+    /*
+        Landmarks are chosen as nodes far away from random starting nodes, which places them on the periphery
+        of the graph where they give good bounds. Each landmark requires two full searches which run in parallel.
+    */
+    static Landmarks compute(const CsrGraph& graph, std::size_t n_landmarks, int_t n_threads) {
+        Landmarks landmarks;
+        landmarks.m_n_landmarks = n_landmarks;
+        landmarks.m_landmarks.resize(n_landmarks);
+        landmarks.m_dist.resize(graph.size() * n_landmarks);
+
+        // Draw starting nodes with a fixed seed so that the landmarks are reproducible.
+        std::mt19937_64 rng(n_landmarks);
+        std::uniform_int_distribution<int_t> node_distribution(0, graph.size() - 1);
+        std::vector<int_t> start_nodes;
+        for (std::size_t attempt = 0; start_nodes.size() < n_landmarks; ++attempt) {
+            int_t v = node_distribution(rng);
+            if (graph.degree(v) > 0 || attempt >= 100 * n_landmarks) start_nodes.push_back(v); // Prefer connected nodes.
+        }
+
+        auto compute_landmarks = [&graph, &landmarks, &start_nodes, n_threads](std::size_t thr) {
+            SearchWorkspace workspace;
+            for (std::size_t l = thr; l < landmarks.size(); l += n_threads) {
+                auto dist = graph.all_distances({{start_nodes[l], 0.0}}, workspace);
+                int_t landmark = start_nodes[l];
+                for (std::size_t v = 0; v < dist.size(); ++v) if (dist[v] != REAL_T_MAX && dist[v] > dist[landmark]) landmark = v;
+                landmarks.m_landmarks[l] = landmark;
+                dist = graph.all_distances({{landmark, 0.0}}, workspace);
+                for (std::size_t v = 0; v < dist.size(); ++v) landmarks.m_dist[v * landmarks.size() + l] = dist[v];
+            }
+        };
+        ThreadPool::instance().run(n_threads, compute_landmarks);
+
+        return landmarks;
+    }
+
+    bool save(const CsrGraph& graph, const std::string& filename) const {
+        std::ofstream ofs(filename, std::ios::binary);
+        if (!ofs) return false;
+        BinaryIO::write_header(ofs, MAGIC, VERSION, graph.fingerprint());
+        BinaryIO::write_vector(ofs, m_landmarks);
+        BinaryIO::write_vector(ofs, m_dist);
+        return (bool) ofs;
+    }
+
+    bool load(const CsrGraph& graph, std::size_t n_landmarks, const std::string& filename) {
+        std::ifstream ifs(filename, std::ios::binary);
+        if (!ifs || !BinaryIO::read_header(ifs, MAGIC, VERSION, graph.fingerprint())) return false;
+        if (!BinaryIO::read_vector(ifs, m_landmarks) || !BinaryIO::read_vector(ifs, m_dist)) return false;
+        m_n_landmarks = m_landmarks.size();
+        return m_n_landmarks == n_landmarks && m_dist.size() == graph.size() * n_landmarks;
+    }
+
+private:
+    static constexpr const char* MAGIC = "UDLM";
+    static constexpr uint32_t VERSION = 2;
+
+    std::size_t m_n_landmarks;
+    std::vector<int_t> m_landmarks;
+    std::vector<real_t> m_dist; // Distances from the landmarks, stored node by node.
+
+};
@@ -0,0 +1,370 @@
+/*
+    Line readers for the text input files. Lines and fields are returned as views into a block of the
+    file, and numbers are parsed from the views, so no strings are allocated per line. Line and field
+    ends are found with memchr, which is vectorized by the C library.
+    LineReader reads a file in large blocks with read(2), so process substitution and pipes are
+    supported, or reads the lines of a range of memory. Files compressed with gzip or zstd are detected
+    from their first bytes and read through gzip -dc or zstd -dc, so decompression runs in a separate
+    process alongside parsing. ChunkedLineReader splits a file into chunks at line boundaries which are
+    parsed in parallel.
+*/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "BinaryIO.hpp"
+#include "ThreadPool.hpp"
+#include "types.hpp"
+
+// Non-owning view of a range of characters, valid until the next line is read.
+class StringView {
+public:
+    StringView() : m_data(nullptr), m_size(0) { }
+    StringView(const char* data, std::size_t size) : m_data(data), m_size(size) { }
+
+    const char* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    char operator[](std::size_t i) const { return m_data[i]; }
+    const char* begin() const { return m_data; }
+    const char* end() const { return m_data + m_size; }
+
+    std::string str() const { return std::string(m_data, m_size); }
+
+private:
+    const char* m_data;
+    std::size_t m_size;
+
+};
+
+enum class Compression { NONE, GZIP, ZSTD };
+
+class LineReader {
+public:
+    // Read the lines of a file in blocks, decompressing it if needed.
+    LineReader(const std::string& filename, std::size_t block_size = 1 << 20)
+    : m_filename(filename),
+      m_pipe(open_decompressor(filename)),
+      m_fd(m_pipe ? fileno(m_pipe) : open(filename.c_str(), O_RDONLY)),
+      m_buffer(block_size),
+      m_pos(m_buffer.data()),
+      m_end(m_buffer.data()),
+      m_eof(m_fd < 0),
+      m_good(m_fd >= 0),
+      m_file_begin(nullptr),
+      m_line(),
+      m_fields(),
+      m_line_number(0)
+    { }
+
+    // Read the lines in [begin, end). If file_begin is given, line numbers are counted from there.
+    LineReader(const char* begin, const char* end, const char* file_begin = nullptr)
+    : m_filename(),
+      m_pipe(nullptr),
+      m_fd(-1),
+      m_buffer(),
+      m_pos(begin),
+      m_end(end),
+      m_eof(true),
+      m_good(true),
+      m_file_begin(file_begin),
+      m_line(),
+      m_fields(),
+      m_line_number(0)
+    { }
+
+    ~LineReader() {
+        if (m_pipe) pclose(m_pipe);
+        else if (m_fd >= 0) close(m_fd);
+    }
+
+    LineReader(const LineReader&) = delete;
+    LineReader& operator=(const LineReader&) = delete;
+
+    // False if the file couldn't be opened or decompressing it failed.
+    bool good() const { return m_good; }
+
+    /*
+        Compression of a file, detected from its first bytes. Only regular files are checked, since
+        reading from a pipe would consume the bytes. Compressed pipes can be decompressed in the process
+        substitution instead.
+    */
+    static Compression compression(const std::string& filename) {
+        struct stat st;
+        if (stat(filename.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return Compression::NONE;
+        unsigned char magic[4] = { 0, 0, 0, 0 };
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return Compression::NONE;
+        ssize_t n_read = read(fd, magic, sizeof(magic));
+        close(fd);
+        if (n_read >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) return Compression::GZIP;
+        if (n_read == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) return Compression::ZSTD;
+        return Compression::NONE;
+    }
+
+    // Name of the program used to decompress a file, empty if the file isn't compressed.
+    static std::string decompressor(const std::string& filename) {
+        switch (compression(filename)) {
+            case Compression::GZIP: return "gzip";
+            case Compression::ZSTD: return "zstd";
+            default: return "";
+        }
+    }
+
+    // Check that the program needed to decompress a file can be found. The lookup is done once per program.
+    static bool can_decompress(const std::string& filename) {
+        static std::mutex mutex;
+        static std::map<std::string, bool> found;
+        auto program = decompressor(filename);
+        if (program.empty()) return true;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = found.find(program);
+        if (it == found.end()) it = found.emplace(program, std::system(("command -v " + program + " > /dev/null 2>&1").c_str()) == 0).first;
+        return it->second;
+    }
+
+    // Advance to the next line, returns false at the end of the input. The newline, or CRLF line ending, is not part of the line.
+    bool next_line() {
+        while (true) {
+            const char* newline = m_pos < m_end ? (const char*) std::memchr(m_pos, '\n', m_end - m_pos) : nullptr;
+            if (newline) {
+                set_line(newline);
+                return true;
+            }
+            if (m_eof) {
+                if (m_pos == m_end) return false;
+                set_line(m_end); // Last line without a newline.
+                return true;
+            }
+            fill();
+        }
+    }
+
+    // Step back to the start of the current line, so that the next call to next_line returns it again.
+    void unread_line() {
+        if (m_line_number == 0) return;
+        m_pos = m_line.begin();
+        --m_line_number;
+    }
+
+    StringView line() const { return m_line; }
+
+    // Line number of the current line, counted from 1. Counting from the start of the file is only done on request.
+    std::size_t line_number() const {
+        if (!m_file_begin) return m_line_number;
+        return std::count(m_file_begin, m_line.begin(), '\n') + 1;
+    }
+
+    /*
+        Split the current line into fields separated by delim. Consecutive delimiters give empty fields,
+        a delimiter at the end of the line doesn't.
+    */
+    const std::vector<StringView>& fields(char delim = ' ') {
+        m_fields.clear();
+        const char* it = m_line.begin();
+        const char* end = m_line.end();
+        while (it < end) {
+            const char* field_end = (const char*) std::memchr(it, delim, end - it);
+            if (!field_end) field_end = end;
+            m_fields.emplace_back(it, field_end - it);
+            it = field_end + 1;
+        }
+        return m_fields;
+    }
+
+    // Parse a whole field as an integer. Fails if the value doesn't fit in int64_t or T.
+    template <typename T>
+    static bool to_int(StringView field, T& value) {
+        static_assert(std::is_integral<T>::value && std::is_signed<T>::value, "to_int parses signed integers");
+        const char* it = field.begin();
+        const char* end = field.end();
+        bool negative = it < end && *it == '-';
+        if (it < end && (*it == '-' || *it == '+')) ++it;
+        if (it == end) return false;
+        // The magnitude is accumulated unsigned, since the magnitude of the smallest int64_t doesn't fit in int64_t.
+        uint64_t limit = (uint64_t) std::numeric_limits<int64_t>::max() + negative;
+        uint64_t x = 0;
+        for ( ; it < end; ++it) {
+            if (*it < '0' || *it > '9') return false;
+            uint64_t digit = *it - '0';
+            if (x > (limit - digit) / 10) return false;
+            x = x * 10 + digit;
+        }
+        int64_t parsed = negative ? -(int64_t) (x - 1) - 1 : (int64_t) x;
+        if (parsed < std::numeric_limits<T>::min() || parsed > std::numeric_limits<T>::max()) return false;
+        value = parsed;
+        return true;
+    }
+
+    // Parse a whole field as a decimal number. The field is copied to a terminated buffer on the stack for strtod.
+    template <typename T>
+    static bool to_real(StringView field, T& value) {
+        char buffer[64];
+        if (field.empty() || field.size() >= sizeof(buffer)) return false;
+        if (!(std::isdigit((unsigned char) field[0]) || field[0] == '-' || field[0] == '+' || field[0] == '.')) return false;
+        std::memcpy(buffer, field.data(), field.size());
+        buffer[field.size()] = '\0';
+        char* parsed_end;
+        errno = 0;
+        double x = std::strtod(buffer, &parsed_end);
+        if (parsed_end != buffer + field.size() || errno == ERANGE) return false;
+        if (x < std::numeric_limits<T>::lowest() || x > std::numeric_limits<T>::max()) return false;
+        value = x;
+        return true;
+    }
+
+private:
+    std::string m_filename;
+    FILE* m_pipe; // Output of the decompressor for compressed files.
+    int m_fd;
+    std::vector<char> m_buffer;
+    const char* m_pos; // Start of the unread part of the input.
+    const char* m_end; // End of the input read so far.
+    bool m_eof;
+    bool m_good;
+    const char* m_file_begin;
+
+    StringView m_line;
+    std::vector<StringView> m_fields;
+    std::size_t m_line_number;
+
+    // Set the current line to [m_pos, line_end), without a trailing carriage return from a CRLF line ending.
+    void set_line(const char* line_end) {
+        std::size_t line_size = line_end - m_pos;
+        if (line_size > 0 && m_pos[line_size - 1] == '\r') --line_size;
+        m_line = StringView(m_pos, line_size);
+        m_pos = std::min(line_end + 1, m_end);
+        ++m_line_number;
+    }
+
+    // Move the partial line to the front of the buffer and read the next block after it. The buffer grows for lines longer than a block.
+    void fill() {
+        std::size_t remaining = m_end - m_pos;
+        std::memmove(m_buffer.data(), m_pos, remaining);
+        if (remaining == m_buffer.size()) m_buffer.resize(2 * m_buffer.size());
+        m_pos = m_buffer.data();
+        m_end = m_pos + remaining;
+
+        ssize_t n_read;
+        do n_read = read(m_fd, m_buffer.data() + remaining, m_buffer.size() - remaining);
+        while (n_read < 0 && errno == EINTR);
+        if (n_read > 0) {
+            m_end += n_read;
+            return;
+        }
+        m_eof = true;
+        if (n_read < 0) m_good = false;
+        if (m_pipe) {
+            if (pclose(m_pipe) != 0) m_good = false;
+            m_pipe = nullptr;
+            m_fd = -1;
+        }
+        if (!m_good) std::cerr << "Error: Failed to read " << m_filename << std::endl;
+    }
+
+    static FILE* open_decompressor(const std::string& filename) {
+        auto program = decompressor(filename);
+        if (program.empty()) return nullptr;
+        std::string quoted_filename = "'";
+        for (char c : filename) quoted_filename += c == '\'' ? std::string("'\\''") : std::string(1, c);
+        quoted_filename += "'";
+        return popen((program + " -dc " + quoted_filename).c_str(), "r");
+    }
+
+};
+
+/*
+    Splits a file into consecutive chunks at line boundaries, so that the lines can be parsed by several
+    threads and the results concatenated in chunk order. Regular files are mapped to memory. Files that
+    can't be mapped, such as pipes from process substitution and compressed files, are read as a
+    single chunk.
+*/
+class ChunkedLineReader {
+public:
+    ChunkedLineReader(const std::string& filename, int_t n_chunks) : m_file(filename), m_stream(), m_bounds() {
+        struct stat st;
+        bool regular_file = stat(filename.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+        bool compressed = LineReader::compression(filename) != Compression::NONE;
+        if (regular_file && !compressed && m_file.good()) {
+            // Chunk boundaries are moved forward to the start of the next line.
+            const char* begin = m_file.data();
+            const char* end = begin + m_file.size();
+            n_chunks = std::max<int_t>(1, std::min<int_t>(n_chunks, m_file.size() / MIN_CHUNK_SIZE));
+            m_bounds.push_back(begin);
+            for (int_t i = 1; i < n_chunks; ++i) {
+                const char* bound = std::max(begin + m_file.size() * i / n_chunks, m_bounds.back());
+                const char* newline = (const char*) std::memchr(bound, '\n', end - bound);
+                m_bounds.push_back(newline ? newline + 1 : end);
+            }
+            m_bounds.push_back(end);
+        } else if (!regular_file || compressed || st.st_size > 0) {
+            m_stream.reset(new LineReader(filename));
+        }
+    }
+
+    // Empty regular files aren't mapped, but they are still good.
+    bool good() const { return !m_stream || m_stream->good(); }
+
+    std::size_t n_chunks() const { return m_bounds.empty() ? 1 : m_bounds.size() - 1; }
+
+    // First line of the file, without consuming it.
+    StringView first_line() {
+        if (m_stream) {
+            if (!m_stream->next_line()) return StringView();
+            m_stream->unread_line();
+            return m_stream->line();
+        }
+        if (m_bounds.empty()) return StringView();
+        LineReader reader(m_bounds.front(), m_bounds.back());
+        reader.next_line();
+        return reader.line();
+    }
+
+    /*
+        Call parse_chunk(chunk_idx, reader) for each chunk in the thread pool. Returns false if any of
+        the calls returned false.
+    */
+    template <typename ParseChunk>
+    bool parse(ParseChunk parse_chunk) {
+        if (m_stream) return parse_chunk(0, *m_stream) && m_stream->good();
+        if (m_bounds.empty()) {
+            LineReader reader(nullptr, nullptr);
+            return parse_chunk(0, reader);
+        }
+
+        std::atomic<bool> ok(true);
+        auto parse_one = [this, &parse_chunk, &ok](std::size_t chunk_idx) {
+            LineReader reader(m_bounds[chunk_idx], m_bounds[chunk_idx + 1], m_bounds.front());
+            if (!parse_chunk(chunk_idx, reader)) ok = false;
+        };
+        ThreadPool::instance().run(n_chunks(), parse_one);
+        return ok;
+    }
+
+private:
+    static constexpr std::size_t MIN_CHUNK_SIZE = 1 << 20;
+
+    MappedFile m_file;
+    std::unique_ptr<LineReader> m_stream;
+    std::vector<const char*> m_bounds;
+
+};
@@ -0,0 +1,97 @@
+/*
+    Priority queues for the Dijkstra searches. Both queues are lazy: a node is pushed again when
+    its distance improves and the search skips stale entries when they are popped.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "types.hpp"
+
+// Binary heap for arbitrary non-negative weights.
+class BinaryHeap {
+public:
+    bool empty() const { return m_heap.empty(); }
+
+    void push(real_t distance, int_t v) {
+        m_heap.emplace_back(distance, v);
+        std::push_heap(m_heap.begin(), m_heap.end(), std::greater<element_t>());
+    }
+
+    std::pair<real_t, int_t> pop() {
+        std::pop_heap(m_heap.begin(), m_heap.end(), std::greater<element_t>());
+        auto top = m_heap.back();
+        m_heap.pop_back();
+        return top;
+    }
+
+    real_t top_distance() const { return m_heap.front().first; }
+
+    void clear() { m_heap.clear(); }
+
+private:
+    using element_t = std::pair<real_t, int_t>;
+    std::vector<element_t> m_heap;
+
+};
+
+/*
+    Radix heap for integer distances (Ahuja et al. 1990). Keys are bucketed by the highest bit in
+    which they differ from the last popped key, so push is O(1) and each element is moved between
+    buckets at most 64 times. Only valid for monotone use, i.e. pushed keys are never smaller than
+    the last popped key, which holds for Dijkstra with non-negative weights.
+*/
+class RadixHeap {
+public:
+    RadixHeap() : m_buckets(65), m_last(0), m_size(0) { }
+
+    bool empty() const { return m_size == 0; }
+
+    void push(real_t distance, int_t v) {
+        uint64_t key = distance;
+        m_buckets[bucket_index(key)].emplace_back(key, v);
+        ++m_size;
+    }
+
+    std::pair<real_t, int_t> pop() {
+        if (m_buckets[0].empty()) redistribute();
+        auto top = m_buckets[0].back();
+        m_buckets[0].pop_back();
+        --m_size;
+        return std::make_pair((real_t) top.first, top.second);
+    }
+
+    real_t top_distance() {
+        if (m_buckets[0].empty()) redistribute();
+        return m_last;
+    }
+
+    void clear() {
+        for (auto& bucket : m_buckets) bucket.clear();
+        m_last = 0;
+        m_size = 0;
+    }
+
+private:
+    std::vector<std::vector<std::pair<uint64_t, int_t>>> m_buckets;
+    uint64_t m_last;
+    std::size_t m_size;
+
+    std::size_t bucket_index(uint64_t key) const { return key == m_last ? 0 : 64 - __builtin_clzll(key ^ m_last); }
+
+    // Move the contents of the first non-empty bucket to lower buckets, relative to its smallest key.
+    void redistribute() {
+        std::size_t idx = 1;
+        while (m_buckets[idx].empty()) ++idx;
+        auto& bucket = m_buckets[idx];
+        m_last = bucket.front().first;
+        for (const auto& element : bucket) m_last = std::min(m_last, element.first);
+        for (const auto& element : bucket) m_buckets[bucket_index(element.first)].push_back(element);
+        bucket.clear();
+    }
+
+};
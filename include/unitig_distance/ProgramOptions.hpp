@@ -23,14 +23,20 @@ public:
         }
         set_value(unitigs_filename, "-U", "--unitigs-file");
         set_value(edges_filename, "-E", "--edges-file");
+        set_value(gfa_filename, "-G", "--gfa-file");
         set_value(queries_filename, "-Q", "--queries-file");
         set_value(sggs_filename, "-S", "--sgg-paths-file");
+        set_value(ch_index_filename, "-ch", "--ch-index");
+        set_value(hub_labels_filename, "-hl", "--hub-labels");
+        set_value(save_graph_filename, "-sg", "--save-graph");
+        set_value(load_graph_filename, "-lg", "--load-graph");
         set_value(out_stem, "-o", "--output-stem");
         set_value(k, "-k", "--k-mer-length");
         set_value(n_queries, "-n", "--n-queries");
         set_value(queries_format, "-q", "--queries-format");
         set_value(max_distance, "-d", "--max-distance");
         set_value(n_threads, "-t", "--threads");
+        set_value(n_landmarks, "-al", "--alt-landmarks");
         set_value(sgg_count_threshold, "-Cc", "--sgg-count-threshold");
         set_value(ld_distance, "-l", "--ld-distance");
         set_value(ld_distance_min, "-lm", "--ld-distance-min");
@@ -45,7 +51,12 @@ public:
             output_one_based = has_arg("-1o", "--output-one-based");
         }
         run_sggs_only = has_arg("-r", "--run-sggs-only");
+        build_ch_index = has_arg("-chb", "--build-ch-index");
+        build_hub_labels = has_arg("-hlb", "--build-hub-labels");
+        compress_paths = has_arg("-cp", "--compress-paths");
+        reorder_nodes = has_arg("-ro", "--reorder-nodes");
         output_outliers = has_arg("-x", "--output-outliers");
+        pin_threads = has_arg("-pin", "--pin-threads");
         verbose = has_arg("-v", "--verbose");
 
         set_operating_mode();
@@ -58,12 +69,20 @@ public:
 
     static bool has_operating_mode(const OperatingMode& om) { return operating_mode_to_bool(operating_mode & om); }
 
+    // Preprocessing mode where only the search indexes for the main graph are built.
+    static bool build_indexes_only() { return build_ch_index || build_hub_labels; }
+
     static std::string out_filename() { return out_stem + ".ud" + based_str(); }
     static std::string out_sgg_filename() { return out_stem + ".ud_sgg" + based_str(); }
     static std::string out_outliers_filename() { return out_stem + ".ud_outliers" + based_str(); }
     static std::string out_sgg_outliers_filename() { return out_stem + ".ud_sgg_outliers" + based_str(); }
     static std::string out_outlier_stats_filename() { return out_stem + ".ud_outlier_stats"; }
     static std::string out_sgg_outlier_stats_filename() { return out_stem + ".ud_sgg_outlier_stats"; }
+    static std::string landmarks_filename() { return main_graph_filename() + ".ud_landmarks"; }
+    static std::string colors_filename() { return sggs_filename + ".ud_colors"; }
+
+    // File the main graph's edges are read from.
+    static const std::string& main_graph_filename() { return gfa_filename.empty() ? edges_filename : gfa_filename; }
 
     // Print details about this run.
     static void print_run_details() {
@@ -73,9 +92,12 @@ public:
             double_push_back(arguments, "  --edges-file", edges_filename);
             double_push_back(arguments, "  --graphs-one-based", graphs_one_based ? "TRUE" : "FALSE");
         }
+        if (!gfa_filename.empty()) double_push_back(arguments, "  --gfa-file", gfa_filename);
+        if (!load_graph_filename.empty()) double_push_back(arguments, "  --load-graph", load_graph_filename);
+        if (!save_graph_filename.empty()) double_push_back(arguments, "  --save-graph", save_graph_filename);
         if (has_operating_mode(OperatingMode::CDBG)) {
-            double_push_back(arguments, "  --unitigs-file", unitigs_filename);
-            double_push_back(arguments, "  --k-mer-length", std::to_string(k));
+            if (gfa_filename.empty()) double_push_back(arguments, "  --unitigs-file", unitigs_filename);
+            double_push_back(arguments, "  --k-mer-length", k > 0 ? std::to_string(k) : "AUTOM");
         }
         if (has_operating_mode(OperatingMode::SGGS)) {
             double_push_back(arguments, "  --sgg-paths-file", sggs_filename);
@@ -86,6 +108,17 @@ public:
         double_push_back(arguments, "  --n-queries", n_queries == INT_T_MAX ? "ALL" : std::to_string(n_queries));
         double_push_back(arguments, "  --queries-format", queries_format < 0 ? "AUTOM" : std::to_string(queries_format));
         double_push_back(arguments, "  --max-distance", max_distance == REAL_T_MAX ? "INF" : std::to_string(max_distance));
+        if (n_landmarks > 0) double_push_back(arguments, "  --alt-landmarks", std::to_string(n_landmarks));
+        if (compress_paths) double_push_back(arguments, "  --compress-paths", "TRUE");
+        if (reorder_nodes) double_push_back(arguments, "  --reorder-nodes", "TRUE");
+        if (!ch_index_filename.empty()) {
+            double_push_back(arguments, "  --ch-index", ch_index_filename);
+            double_push_back(arguments, "  --build-ch-index", build_ch_index ? "TRUE" : "FALSE");
+        }
+        if (!hub_labels_filename.empty()) {
+            double_push_back(arguments, "  --hub-labels", hub_labels_filename);
+            double_push_back(arguments, "  --build-hub-labels", build_hub_labels ? "TRUE" : "FALSE");
+        }
         if (has_operating_mode(OperatingMode::OUTLIER_TOOLS)) {
             double_push_back(arguments, "  --output-outliers", output_outliers ? "TRUE" : "FALSE");
             double_push_back(arguments, "  --sgg-count-threshold", std::to_string(sgg_count_threshold));
@@ -101,6 +134,7 @@ public:
         double_push_back(arguments, "  --output-stem", out_stem);
         double_push_back(arguments, "  --output-one-based", output_one_based ? "TRUE" : "FALSE");
         double_push_back(arguments, "  --threads", std::to_string(n_threads));
+        double_push_back(arguments, "  --pin-threads", pin_threads ? "TRUE" : "FALSE");
 
         std::cout << "Using following arguments:" << std::endl;
         for (std::size_t i = 0; i < arguments.size(); i += 2) std::printf("%-30s %s\n", arguments[i].data(), arguments[i + 1].data());
@@ -111,14 +145,20 @@ public:
 
     static std::string unitigs_filename;
     static std::string edges_filename;
+    static std::string gfa_filename;
     static std::string queries_filename;
     static std::string sggs_filename;
+    static std::string ch_index_filename;
+    static std::string hub_labels_filename;
+    static std::string save_graph_filename;
+    static std::string load_graph_filename;
     static std::string out_stem;
     static int_t k;
     static int_t n_queries;
     static int_t queries_format;
     static real_t max_distance;
     static int_t n_threads;
+    static int_t n_landmarks;
     static int_t sgg_count_threshold;
     static int_t ld_distance;
     static int_t ld_distance_min;
@@ -129,7 +169,12 @@ public:
     static bool queries_one_based;
     static bool output_one_based;
     static bool run_sggs_only;
+    static bool build_ch_index;
+    static bool build_hub_labels;
+    static bool compress_paths;
+    static bool reorder_nodes;
     static bool output_outliers;
+    static bool pin_threads;
     static bool verbose;
     static bool valid_state;
     static OperatingMode operating_mode;
@@ -140,7 +185,10 @@ private:
 
     static void set_operating_mode() {
         if (output_outliers) operating_mode |= OperatingMode::OUTLIER_TOOLS;
-        if (!edges_filename.empty()) {
+        if (!gfa_filename.empty()) {
+            operating_mode |= OperatingMode::CDBG;
+            if (!sggs_filename.empty()) operating_mode |= OperatingMode::SGGS;
+        } else if (!edges_filename.empty()) {
             if (unitigs_filename.empty()) {
                 operating_mode |= OperatingMode::GENERAL;
             } else {
@@ -152,25 +200,52 @@ private:
 
     static bool all_required_arguments_provided() {
         bool ok = true;
-        // Always require queries.
-        if (queries_filename.empty()) {
+        // Building the search indexes only requires the graph.
+        if (build_ch_index && ch_index_filename.empty()) {
+            std::cerr << "Error: Missing contraction hierarchy index filename.\n";
+            ok = false;
+        }
+        if (build_hub_labels && hub_labels_filename.empty()) {
+            std::cerr << "Error: Missing hub labels filename.\n";
+            ok = false;
+        }
+        // Otherwise always require queries.
+        if (queries_filename.empty() && !build_indexes_only()) {
             std::cerr << "Error: Missing queries filename.\n";
             ok = false;
         }
+        if (n_landmarks < 0) {
+            std::cerr << "Error: Number of landmarks can't be negative.\n";
+            ok = false;
+        }
         if (queries_format > 5) {
             std::cerr << "Error: Queries format must be less than 6.\n";
             ok = false;
         }
         // Normal operating modes.
         if (operating_mode != OperatingMode::OUTLIER_TOOLS) {
-            if (edges_filename.empty()) {
+            if (edges_filename.empty() && gfa_filename.empty()) {
                 std::cerr << "Error: Missing edges filename.\n";
                 ok = false;
             }
-            if (has_operating_mode(OperatingMode::CDBG) && k <= 0) {
+            if (!gfa_filename.empty() && (!edges_filename.empty() || !unitigs_filename.empty())) {
+                std::cerr << "Error: GFA file can't be used together with edges and unitigs files.\n";
+                ok = false;
+            }
+            // k-mer length can be deduced from the overlaps in a GFA file.
+            if (has_operating_mode(OperatingMode::CDBG) && gfa_filename.empty() && k <= 0) {
                 std::cerr << "Error: Missing k-mer length.\n";
                 ok = false;
             }
+            if (compress_paths && !has_operating_mode(OperatingMode::CDBG)) {
+                std::cerr << "Error: Compressing paths requires a compacted de Bruijn graph.\n";
+                ok = false;
+            }
+            // The compressed graph is searched on its own, without the other search accelerations.
+            if (compress_paths && (n_landmarks > 0 || !ch_index_filename.empty() || !hub_labels_filename.empty())) {
+                std::cerr << "Error: Compressing paths can't be used together with landmarks, contraction hierarchy index or hub labels.\n";
+                ok = false;
+            }
         } else {
             // Correct queries format required, i.e. 4 or 5.
             if (queries_format >= 0 && queries_format < 4) {
@@ -207,10 +282,13 @@ private:
             "Graph edges:", "",
             "  -E  [ --edges-file ] arg", "Path to file containing graph edges.",
             "  -1g [ --graphs-one-based ]", "Graph files use one-based numbering.",
+            "  -sg [ --save-graph ] arg", "Save the constructed main graph to a binary file for faster loading.",
+            "  -lg [ --load-graph ] arg", "Load the main graph from a binary file saved from the same graph files.",
             "", "",
             "CDBG operating mode:", "",
             "  -U  [ --unitigs-file ] arg", "Path to file containing unitigs.",
             "  -k  [ --k-mer-length ] arg", "k-mer length.",
+            "  -G  [ --gfa-file ] arg", "Path to GFA1 file containing the graph (instead of edges and unitigs files).",
             "", "",
             "CDBG and/or SGGS operating mode:", "",
             "  -S  [ --sgg-paths-file ] arg", "Path to file containing paths to single genome graph edge files.",
@@ -223,6 +301,15 @@ private:
             "  -q  [ --queries-format ] arg (-1)", "Set queries format manually (0..5).",
             "  -d  [ --max-distance ] arg (=inf)", "Maximum allowed graph distance (for constraining the searches).",
             "", "",
+            "Search acceleration:", "",
+            "  -cp [ --compress-paths ]", "Search the main graph with its paths of degree-2 nodes compressed into single edges.",
+            "  -ro [ --reorder-nodes ]", "Renumber the main graph's nodes for better memory locality in the searches (also when building indexes).",
+            "  -al [ --alt-landmarks ] arg (=0)", "Number of landmarks for goal-directed searches in the main graph (saved next to the edges file).",
+            "  -ch [ --ch-index ] arg", "Path to contraction hierarchy index used for searches in the main graph.",
+            "  -chb [ --build-ch-index ]", "Build the contraction hierarchy index for the main graph and exit.",
+            "  -hl [ --hub-labels ] arg", "Path to hub labels used for answering queries in the main graph without searching.",
+            "  -hlb [ --build-hub-labels ]", "Build the hub labels for the main graph and exit.",
+            "", "",
             "Tools for determining outliers:", "",
             "  -x  [ --output-outliers ]", "Output a list of outliers and outlier statistics.",
             "  -Cc [ --sgg-count-threshold ] arg (=10)", "Filter low count single genome graph distances.",
@@ -237,6 +324,7 @@ private:
             "  -1o [ --output-one-based ]", "Output files use one-based numbering.",
             "  -1  [ --all-one-based ]", "Use one-based numbering for everything.",
             "  -t  [ --threads ] arg (=1)", "Number of threads.",
+            "  -pin [ --pin-threads ]", "Pin worker threads to CPU cores.",
             "  -v  [ --verbose ]", "Be verbose.",
             "  -h  [ --help ]", "Print this list.",
         };
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <utility>
 #include <vector>
 
@@ -35,6 +36,15 @@ public:
     void add_flag(bool flag) { m_flags.emplace_back(flag); }
     void add_distance(int_t distance, int_t count = 1) { m_distances.emplace_back(distance, count); }
 
+    // Append queries read from a later part of the file.
+    void append(const Queries& other) {
+        m_queries.insert(m_queries.end(), other.m_queries.begin(), other.m_queries.end());
+        m_flags.insert(m_flags.end(), other.m_flags.begin(), other.m_flags.end());
+        m_scores.insert(m_scores.end(), other.m_scores.begin(), other.m_scores.end());
+        for (const auto& distance : other.m_distances) m_distances.emplace_back(distance.distance(), distance.count());
+        m_largest_v = std::max(m_largest_v, other.m_largest_v);
+    }
+
     bool extended_format() const { return m_scores.size() > 0; }
 
     //typename std::vector<std::pair<int_t, int_t>>::iterator begin() { return m_queries.begin(); }
@@ -43,7 +53,7 @@ public:
     //typename std::vector<std::pair<int_t, int_t>>::const_iterator end() const { return m_queries.end(); }
 
 private:
-    std::vector<std::pair<int_t, int_t>> m_queries;
+    std::vector<std::pair<node_t, node_t>> m_queries;
     std::vector<bool> m_flags;
     std::vector<real_t> m_scores;
     DistanceVector m_distances;
@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "DistanceVector.hpp"
+#include "LineReader.hpp"
 #include "PrintUtils.hpp"
 #include "Queries.hpp"
 #include "Timer.hpp"
@@ -24,11 +25,13 @@
 class QueriesReader {
 public:
     static Queries read_queries(Timer& timer) {
-        std::ifstream ifs(ProgramOptions::queries_filename);
-        std::string line;
-        std::getline(ifs, line);
+        // Reading is limited to the first lines with -n [ --n-queries ], so the file is then read by one thread.
+        ChunkedLineReader file(ProgramOptions::queries_filename, ProgramOptions::n_queries > 0 ? 1 : ProgramOptions::n_threads);
+        auto first_line = file.first_line();
+        LineReader first_line_reader(first_line.begin(), first_line.end());
+        first_line_reader.next_line();
 
-        int_t queries_format = ProgramOptions::queries_format < 0 ? Utils::deduce_queries_format(line) : ProgramOptions::queries_format;
+        int_t queries_format = ProgramOptions::queries_format < 0 ? Utils::deduce_queries_format(first_line_reader.fields().size()) : ProgramOptions::queries_format;
         if (queries_format < 0) {
             std::cerr << "Error: Could not automatically deduce queries format. Please set it with option -q [ --queries-type ] arg." << std::endl;
             return Queries();
@@ -39,37 +42,51 @@ public:
         }
         if (ProgramOptions::verbose) PrintUtils::print_tbssasm(timer, "Reading queries with format:", Utils::get_queries_format_string(queries_format));
 
-        Queries queries(queries_format);
-
         int_t distance_field, flag_field, score_field, count_field;
         std::tie(distance_field, flag_field, score_field, count_field) = Utils::get_field_indices(queries_format);
         std::size_t n_fields = Utils::get_queries_n_fields(queries_format);
 
-        if (distance_field && count_field) queries.set_mean_distances();
-
-        int_t n = 0;
-        auto n_queries = ProgramOptions::n_queries > 0 ? ProgramOptions::n_queries : INT_T_MAX;
+        std::size_t n_queries = ProgramOptions::n_queries > 0 ? ProgramOptions::n_queries : INT_T_MAX;
 
-        do {
-            auto fields = Utils::get_fields(line);
-            if (fields.size() < n_fields) {
-                print_error(line, n_fields, n + 1);
-                return Queries();
-            }
-            int_t v = std::stoll(fields[0]) - ProgramOptions::queries_one_based;
-            int_t w = std::stoll(fields[1]) - ProgramOptions::queries_one_based;
-            queries.add_vertices(v, w);
-            if (flag_field) queries.add_flag(std::stoi(fields[flag_field]));
-            if (score_field) queries.add_score(std::stod(fields[score_field]));
-            if (distance_field) {
-                real_t distance = std::stod(fields[distance_field]);
-                int_t count = count_field ? std::stoll(fields[count_field]) : 1;
-                queries.add_distance(distance, count);
+        // Chunks of the file are parsed in parallel into separate queries, which are appended in file order.
+        std::vector<Queries> chunk_queries(file.n_chunks(), Queries(queries_format));
+        bool ok = file.parse([&chunk_queries, n_queries, n_fields, distance_field, flag_field, score_field, count_field](std::size_t chunk_idx, LineReader& reader) {
+            auto& queries = chunk_queries[chunk_idx];
+            while (queries.size() < n_queries && reader.next_line()) {
+                const auto& fields = reader.fields();
+                if (fields.size() < n_fields) {
+                    print_error(reader.line().str(), n_fields, reader.line_number());
+                    return false;
+                }
+                int_t v, w, flag = 0, count = 1;
+                real_t score = 0.0, distance = 0.0;
+                if (!LineReader::to_int(fields[0], v) || !LineReader::to_int(fields[1], w)
+                    || (flag_field && !LineReader::to_int(fields[flag_field], flag))
+                    || (score_field && !LineReader::to_real(fields[score_field], score))
+                    || (distance_field && !LineReader::to_real(fields[distance_field], distance))
+                    || (count_field && !LineReader::to_int(fields[count_field], count)))
+                {
+                    print_parse_error(reader.line().str(), reader.line_number());
+                    return false;
+                }
+                v -= ProgramOptions::queries_one_based;
+                w -= ProgramOptions::queries_one_based;
+                if (!Utils::valid_node(v) || !Utils::valid_node(w)) {
+                    print_node_range_error(reader.line().str(), reader.line_number());
+                    return false;
+                }
+                queries.add_vertices(v, w);
+                if (flag_field) queries.add_flag(flag);
+                if (score_field) queries.add_score(score);
+                if (distance_field) queries.add_distance(distance, count);
             }
+            return true;
+        });
+        if (!ok) return Queries();
 
-            if (++n >= n_queries) break;
-        } while (std::getline(ifs, line));
-
+        Queries queries(queries_format);
+        if (distance_field && count_field) queries.set_mean_distances();
+        for (const auto& chunk : chunk_queries) queries.append(chunk);
         return queries;
     }
 
@@ -79,4 +96,13 @@ private:
                   << "\" line " << count << " \"" << line << "\". Is the file space-separated?" << std::endl;
     }
 
+    static void print_parse_error(const std::string& line, int_t count) {
+        std::cerr << "Error: Could not parse queries file \"" << ProgramOptions::queries_filename << "\" line " << count << " \"" << line << "\"." << std::endl;
+    }
+
+    static void print_node_range_error(const std::string& line, int_t count) {
+        std::cerr << "Error: Vertex index out of range in queries file \"" << ProgramOptions::queries_filename << "\" line " << count << " \"" << line
+                  << "\", vertex indices must be below " << NODE_T_MAX << " in this build." << std::endl;
+    }
+
 };
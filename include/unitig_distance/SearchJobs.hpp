@@ -1,10 +1,14 @@
 #pragma once
 
-#include <set>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 #include "Queries.hpp"
+#include "ThreadPool.hpp"
 #include "types.hpp"
 
 // Distance queries for node v.
@@ -13,7 +17,7 @@ public:
     SearchJob() = delete;
     SearchJob(int_t v) : m_v(v)  { }
     const int_t v() const { return m_v; }
-    const std::vector<int_t>& ws() const { return m_ws; }
+    const std::vector<node_t>& ws() const { return m_ws; }
     const int_t original_index(std::size_t idx) const { return m_original_indices[idx]; }
     void add(int_t w, int_t idx) {
         m_ws.push_back(w);
@@ -23,53 +27,73 @@ public:
 
 private:
     int_t m_v;
-    std::vector<int_t> m_ws;
+    std::vector<node_t> m_ws;
     std::vector<int_t> m_original_indices;
 
 };
 
-// Clean up later.
+/*
+    Search jobs covering all queries. Vertices are chosen greedily by their number of remaining queries,
+    and each chosen vertex's search covers its queries to vertices that haven't been chosen yet. Queries are
+    stored by vertex in a flat array built in parallel, and vertices are kept in buckets by their number of
+    remaining queries, so that choosing a vertex and updating its neighbors takes constant time.
+*/
 class SearchJobs {
 public:
     SearchJobs() = delete;
-    SearchJobs(const Queries& queries) : m_n_queries(queries.size()) {
-        auto sz = queries.largest_v() + 1;
-        // Store queries by vertex, storing also the original indices.
-        std::vector<std::vector<std::pair<int_t, int_t>>> queries_map(sz);
-        for (std::size_t idx = 0; idx < queries.size(); ++idx) {
-            auto v = queries.v(idx);
-            auto w = queries.w(idx);
-            queries_map[v].emplace_back(w, idx);
-            queries_map[w].emplace_back(v, idx);
-        }
-        // Get query counts for the vertices.
-        std::set<std::pair<int_t, int_t>> n_queries_set; // (v_n_queries, v) pairs.
-        std::vector<int_t> n_queries(sz);
-        for (int_t v = 0; v < sz; ++v) {
-            int_t v_n_queries = queries_map[v].size();
-            if (v_n_queries == 0) continue;
-            n_queries_set.emplace(v_n_queries, v);
-            n_queries[v] = v_n_queries;
+    SearchJobs(const Queries& queries, int_t n_threads = 1) : m_n_queries(queries.size()) {
+        std::size_t sz = queries.largest_v() + 1;
+        std::vector<int_t> offsets;
+        std::vector<std::pair<node_t, int_t>> query_adjacency; // (w, original index) pairs for each vertex.
+        build_query_adjacency(queries, n_threads, offsets, query_adjacency);
+
+        // Doubly linked list of vertices for each remaining query count, vertices that moved to the bucket earlier come first.
+        std::vector<int_t> n_queries(sz), head, tail, next(sz, -1), prev(sz, -1);
+        int_t max_n_queries = 0;
+        for (std::size_t v = 0; v < sz; ++v) {
+            n_queries[v] = offsets[v + 1] - offsets[v];
+            max_n_queries = std::max(max_n_queries, n_queries[v]);
         }
+        head.resize(max_n_queries + 1, -1);
+        tail.resize(max_n_queries + 1, -1);
+        auto insert = [&n_queries, &head, &tail, &next, &prev](int_t v) {
+            auto count = n_queries[v];
+            prev[v] = tail[count];
+            next[v] = -1;
+            if (tail[count] >= 0) next[tail[count]] = v;
+            else head[count] = v;
+            tail[count] = v;
+        };
+        auto remove = [&n_queries, &head, &tail, &next, &prev](int_t v) {
+            if (prev[v] >= 0) next[prev[v]] = next[v];
+            else head[n_queries[v]] = next[v];
+            if (next[v] >= 0) prev[next[v]] = prev[v];
+            else tail[n_queries[v]] = prev[v];
+        };
+        // Initially the largest vertex comes first in each bucket.
+        for (std::size_t v = sz; v-- > 0; ) if (n_queries[v] > 0) insert(v);
+
         // Calculate optimal search jobs.
         std::vector<bool> processed(sz);
-        while (n_queries_set.rbegin()->first != 0) { // Always points to largest value (v with most queries).
-            auto it = std::prev(n_queries_set.end());
-            int_t v = it->second;
-            n_queries_set.erase(it);
+        for (int_t count = max_n_queries; count > 0; ) {
+            int_t v = head[count];
+            if (v < 0) {
+                --count;
+                continue;
+            }
+            remove(v);
             n_queries[v] = 0;
             processed[v] = true;
             SearchJob job(v);
             // Add remaining (v, w) queries for v.
-            for (auto q : queries_map[v]) {
+            for (int_t i = offsets[v]; i < offsets[v + 1]; ++i) {
                 int_t w, idx;
-                std::tie(w, idx) = q;
+                std::tie(w, idx) = query_adjacency[i];
                 if (processed[w]) continue;
                 job.add(w, idx);
-                // Update query count trackers for w.
-                n_queries_set.erase(std::make_pair(n_queries[w], w));
-                --n_queries[w];
-                n_queries_set.emplace(n_queries[w], w);
+                // Move w to the bucket below.
+                remove(w);
+                if (--n_queries[w] > 0) insert(w);
             }
             m_search_jobs.push_back(std::move(job));
         }
@@ -87,4 +111,44 @@ private:
 
     int_t m_n_queries;
 
+    // Store the queries of each vertex in CSR format, in order of their original indices.
+    static void build_query_adjacency(const Queries& queries, int_t n_threads, std::vector<int_t>& offsets, std::vector<std::pair<node_t, int_t>>& query_adjacency) {
+        std::size_t sz = queries.largest_v() + 1;
+        std::size_t stride = std::max<int_t>(n_threads, 1);
+        auto run_in_parallel = [stride](const std::function<void(std::size_t)>& f) { ThreadPool::instance().run(stride, f); };
+
+        std::vector<std::atomic<int_t>> cursors(sz);
+        for (auto& cursor : cursors) cursor.store(0, std::memory_order_relaxed);
+        run_in_parallel([&queries, &cursors, stride](std::size_t thr) {
+            for (std::size_t idx = thr; idx < queries.size(); idx += stride) {
+                cursors[queries.v(idx)].fetch_add(1, std::memory_order_relaxed);
+                cursors[queries.w(idx)].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+
+        offsets.assign(sz + 1, 0);
+        for (std::size_t v = 0; v < sz; ++v) {
+            offsets[v + 1] = offsets[v] + cursors[v].load(std::memory_order_relaxed);
+            cursors[v].store(offsets[v], std::memory_order_relaxed);
+        }
+
+        query_adjacency.resize(offsets[sz]);
+        run_in_parallel([&queries, &cursors, &query_adjacency, stride](std::size_t thr) {
+            for (std::size_t idx = thr; idx < queries.size(); idx += stride) {
+                auto v = queries.v(idx);
+                auto w = queries.w(idx);
+                query_adjacency[cursors[v].fetch_add(1, std::memory_order_relaxed)] = std::make_pair((node_t) w, (int_t) idx);
+                query_adjacency[cursors[w].fetch_add(1, std::memory_order_relaxed)] = std::make_pair((node_t) v, (int_t) idx);
+            }
+        });
+
+        // Threads fill each vertex's queries in any order, restore the order of the original indices.
+        run_in_parallel([&offsets, &query_adjacency, sz, stride](std::size_t thr) {
+            for (std::size_t v = thr; v < sz; v += stride) {
+                std::sort(query_adjacency.begin() + offsets[v], query_adjacency.begin() + offsets[v + 1],
+                          [](const std::pair<node_t, int_t>& a, const std::pair<node_t, int_t>& b) { return a.second < b.second; });
+            }
+        });
+    }
+
 };
@@ -0,0 +1,127 @@
+/*
+    Per-thread working memory for the graph searches, reused across search jobs and graphs.
+    Holds separate distances and queues for the backward half of bidirectional searches. A* searches
+    cache node potentials in the backward distance array instead.
+    Distances and target markers are stamped with the current search epoch, so starting a new
+    search only increments the epoch instead of clearing arrays the size of the graph. The backward
+    half has its own epoch, so it can be restarted while the forward distances are kept.
+    The bitsets of multi-source breadth-first searches are cleared node by node after each search
+    instead, since only the visited nodes are touched.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "PriorityQueues.hpp"
+#include "types.hpp"
+
+// Working memory of a multi-source breadth-first search, where bit i of a node's bitset stands for source i.
+struct BfsBitsets {
+    // Target of source i at position target_idx of its target list. Entries of the same node are chained with next.
+    struct Target {
+        int_t source;
+        int_t target_idx;
+        int_t next;
+    };
+
+    std::vector<uint64_t> seen;      // Sources that have reached the node.
+    std::vector<uint64_t> frontier;  // Sources that reached the node on the current level.
+    std::vector<uint64_t> next;      // Sources that reach the node on the next level.
+    std::vector<uint64_t> target_of; // Sources that have the node as a target.
+    std::vector<int_t> target_head;  // First target entry of the node, -1 if none.
+    std::vector<Target> targets;
+
+    std::vector<int_t> current;  // Nodes on the current level.
+    std::vector<int_t> upcoming; // Nodes on the next level.
+    std::vector<int_t> visited;  // Nodes with a nonzero seen bitset.
+
+    void resize(std::size_t sz) {
+        if (sz <= seen.size()) return;
+        seen.resize(sz, 0);
+        frontier.resize(sz, 0);
+        next.resize(sz, 0);
+        target_of.resize(sz, 0);
+        target_head.resize(sz, -1);
+    }
+};
+
+class SearchWorkspace {
+public:
+    SearchWorkspace() : m_dist(), m_backward_dist(), m_dist_stamp(), m_backward_dist_stamp(), m_target_stamp(), m_epoch(0), m_backward_epoch(0), m_default_distance(REAL_T_MAX) { }
+
+    // Prepare for a new search in a graph with sz nodes.
+    void reset(std::size_t sz, real_t default_distance) {
+        if (sz > m_dist.size()) {
+            m_dist.resize(sz);
+            m_backward_dist.resize(sz);
+            m_dist_stamp.resize(sz, 0);
+            m_backward_dist_stamp.resize(sz, 0);
+            m_target_stamp.resize(sz, 0);
+        }
+        if (++m_epoch == 0) {
+            // Epoch wrapped around, stamps have to be cleared once.
+            std::fill(m_dist_stamp.begin(), m_dist_stamp.end(), 0);
+            std::fill(m_target_stamp.begin(), m_target_stamp.end(), 0);
+            m_epoch = 1;
+        }
+        m_default_distance = default_distance;
+        m_radix_heap.clear();
+        m_binary_heap.clear();
+        reset_backward();
+    }
+
+    // Prepare for a new backward search, keeping the forward distances.
+    void reset_backward() {
+        if (++m_backward_epoch == 0) {
+            std::fill(m_backward_dist_stamp.begin(), m_backward_dist_stamp.end(), 0);
+            m_backward_epoch = 1;
+        }
+        m_backward_radix_heap.clear();
+        m_backward_binary_heap.clear();
+    }
+
+    real_t dist(int_t v) const { return m_dist_stamp[v] == m_epoch ? m_dist[v] : m_default_distance; }
+    void set_dist(int_t v, real_t distance) { m_dist[v] = distance; m_dist_stamp[v] = m_epoch; }
+
+    real_t backward_dist(int_t v) const { return m_backward_dist_stamp[v] == m_backward_epoch ? m_backward_dist[v] : m_default_distance; }
+    void set_backward_dist(int_t v, real_t distance) { m_backward_dist[v] = distance; m_backward_dist_stamp[v] = m_backward_epoch; }
+
+    bool has_potential(int_t v) const { return m_backward_dist_stamp[v] == m_backward_epoch; }
+    real_t potential(int_t v) const { return m_backward_dist[v]; }
+    void set_potential(int_t v, real_t potential) { set_backward_dist(v, potential); }
+
+    bool is_target(int_t v) const { return m_target_stamp[v] == m_epoch; }
+    void set_target(int_t v) { m_target_stamp[v] = m_epoch; }
+    void unset_target(int_t v) { m_target_stamp[v] = 0; }
+
+    RadixHeap& radix_heap() { return m_radix_heap; }
+    BinaryHeap& binary_heap() { return m_binary_heap; }
+    RadixHeap& backward_radix_heap() { return m_backward_radix_heap; }
+    BinaryHeap& backward_binary_heap() { return m_backward_binary_heap; }
+
+    // Bitsets for a multi-source breadth-first search in a graph with sz nodes.
+    BfsBitsets& bfs_bitsets(std::size_t sz) {
+        m_bfs_bitsets.resize(sz);
+        return m_bfs_bitsets;
+    }
+
+private:
+    std::vector<real_t> m_dist;
+    std::vector<real_t> m_backward_dist;
+    std::vector<uint32_t> m_dist_stamp;
+    std::vector<uint32_t> m_backward_dist_stamp;
+    std::vector<uint32_t> m_target_stamp;
+    uint32_t m_epoch;
+    uint32_t m_backward_epoch;
+    real_t m_default_distance;
+
+    RadixHeap m_radix_heap;
+    BinaryHeap m_binary_heap;
+    RadixHeap m_backward_radix_heap;
+    BinaryHeap m_backward_binary_heap;
+
+    BfsBitsets m_bfs_bitsets;
+
+};
@@ -5,17 +5,23 @@
 #include <utility>
 #include <vector>
 
-#include "Graph.hpp"
+#include "Components.hpp"
+#include "CsrGraph.hpp"
 #include "types.hpp"
 
-class SingleGenomeGraph : public Graph {
+class SingleGenomeGraph : public CsrGraph {
 public:
-    SingleGenomeGraph() : Graph() { }
+    SingleGenomeGraph() : CsrGraph() { }
     ~SingleGenomeGraph() = default;
     SingleGenomeGraph(const SingleGenomeGraph& other) = delete;
-    SingleGenomeGraph(SingleGenomeGraph&& other) : Graph(std::move(other)), m_paths(std::move(other.m_paths)), m_node_map(std::move(other.m_node_map)) { }
+    SingleGenomeGraph(SingleGenomeGraph&& other)
+    : CsrGraph(std::move(other)),
+      m_paths(std::move(other.m_paths)),
+      m_node_map(std::move(other.m_node_map)),
+      m_components(std::move(other.m_components))
+    { }
 
-    bool is_on_path(int_t original_idx) const { return path_idx(original_idx) != INT_T_MAX; }
+    bool is_on_path(int_t original_idx) const { return path_idx(original_idx) != NODE_T_MAX; }
 
     bool contains(int_t original_idx) const { return original_idx < (int_t) m_node_map.size() && is_mapped(original_idx); }
 
@@ -25,13 +31,18 @@ public:
 
     int_t mapped_idx(int_t original_idx) const { return m_node_map[original_idx].second; }
 
-    bool is_mapped(int_t original_idx) const { return mapped_idx(original_idx) != INT_T_MAX; }
+    bool is_mapped(int_t original_idx) const { return mapped_idx(original_idx) != NODE_T_MAX; }
 
     // Used by SingleGenomeGraphBuilder.
     void map_node(int_t original_idx, int_t path_idx, int_t mapped_idx) { m_node_map[original_idx] = std::make_pair(path_idx, mapped_idx); }
-    void resize_node_map(std::size_t sz) { m_node_map.resize(sz, std::make_pair(INT_T_MAX, INT_T_MAX)); }
+    void resize_node_map(std::size_t sz) { m_node_map.resize(sz, std::make_pair(NODE_T_MAX, NODE_T_MAX)); }
     std::size_t n_paths() const { return m_paths.size(); }
     void add_new_path(int_t start_node, int_t end_node, std::vector<real_t>&& D) { m_paths.emplace_back(start_node, end_node, std::move(D)); }
+    void set_graph(CsrGraph&& graph) { CsrGraph::operator=(std::move(graph)); }
+    void set_components(Components&& components) { m_components = std::move(components); }
+
+    // Original nodes v and w are in the same component. Sides of a node and nodes on a path are connected to the path's start node.
+    bool connected_original(int_t v, int_t w) const { return m_components.connected(component_node(left_node(v)), component_node(left_node(w))); }
 
     // Path accessors.
     int_t start_node(int_t path_idx) const { return m_paths[path_idx].start_node; }
@@ -58,9 +69,10 @@ public:
 
     SingleGenomeGraph& operator=(const SingleGenomeGraph& other) = delete;
     SingleGenomeGraph& operator=(SingleGenomeGraph&& other) {
-        Graph::operator=(std::move(other));
+        CsrGraph::operator=(std::move(other));
         m_paths = std::move(other.m_paths);
         m_node_map = std::move(other.m_node_map);
+        m_components = std::move(other.m_components);
         return *this;
     }
 
@@ -79,7 +91,12 @@ private:
     };
     std::vector<Path> m_paths;
 
-    std::vector<std::pair<int_t, int_t>> m_node_map; // Map original graph indices to this graph as (path_idx, mapped_idx) pairs.
+    std::vector<std::pair<node_t, node_t>> m_node_map; // Map original graph indices to this graph as (path_idx, mapped_idx) pairs, NODE_T_MAX if not on a path or not mapped.
+
+    Components m_components;
+
+    // A node of this graph in the same component as the original node.
+    int_t component_node(int_t original_idx) const { return is_on_path(original_idx) ? start_node(path_idx(original_idx)) : mapped_idx(original_idx); }
 
 };
 
@@ -2,19 +2,27 @@
 
 #include <string>
 
-#include "GraphBuilder.hpp"
+#include "ColoredEdgeIndex.hpp"
+#include "Components.hpp"
+#include "CsrGraph.hpp"
+#include "Graph.hpp"
 #include "SingleGenomeGraph.hpp"
 #include "types.hpp"
 
 class SingleGenomeGraphBuilder {
 public:
-    // Construct a compressed single genome graph, which is an edge-induced subgraph from the compacted de Bruijn graph.
-    static SingleGenomeGraph build_sgg(const Graph& cdbg, const std::string& edges_filename) {
-        SingleGenomeGraph sgg;
-
-        Graph subgraph = GraphBuilder::build_cdbg_subgraph(cdbg, edges_filename);
-
+    // Construct a compressed single genome graph, which is an edge-induced subgraph from the compacted de Bruijn graph, from the genome's color in the index.
+    static SingleGenomeGraph build_sgg(const CsrGraph& cdbg, const ColoredEdgeIndex& index, int_t color) {
+        ColoredSubgraph subgraph(cdbg, index, color);
         if (subgraph.size() == 0) return SingleGenomeGraph();
+        return compress_paths(subgraph);
+    }
+
+    // Construct a graph where each path of degree-2 nodes in a two-sided graph is compressed into a single edge. Nodes with no edges are left out.
+    template <typename SubgraphT>
+    static SingleGenomeGraph compress_paths(const SubgraphT& subgraph) {
+        SingleGenomeGraph sgg;
+        Graph compressed; // Frozen into sgg after construction.
 
         sgg.resize_node_map(subgraph.size());
 
@@ -23,39 +31,42 @@ public:
         // Run a DFS on the edge-induced subgraph to construct a graph with compressed paths.
         for (int_t v = 0; v < (int_t) subgraph.size(); ++v) {
             if (visited[v] || subgraph.degree(v) == 0) continue;
-            add_and_map_node(sgg, v);
+            add_and_map_node(sgg, compressed, v);
             visited[v] = true;
             std::vector<std::tuple<int_t, int_t, real_t>> stack;
-            dfs_add_neighbors_to_stack(subgraph, visited, stack, v);
+            dfs_add_neighbors_to_stack(subgraph, stack, v);
             while (!stack.empty()) {
                 int_t parent, w;
                 real_t weight;
                 std::tie(parent, w, weight) = stack.back();
                 stack.pop_back();
                 if (visited[w]) {
-                    if (!sgg.is_on_path(w)) sgg.add_edge(sgg.mapped_idx(parent), sgg.mapped_idx(w), weight); // Edge might not be added yet.
+                    if (!sgg.is_on_path(w)) compressed.add_edge(sgg.mapped_idx(parent), sgg.mapped_idx(w), weight); // Edge might not be added yet.
                     continue;
                 }
                 if (subgraph.degree(w) == 2) {
                     // Compress the path into a single edge, updating w and weight.
-                    std::tie(w, weight) = process_path(sgg, subgraph, visited, parent, w, weight);
+                    std::tie(w, weight) = process_path(sgg, compressed, subgraph, visited, parent, w, weight);
                     if (w == parent) continue; // Path looped back to parent.
                 }
-                if (!sgg.is_mapped(w)) add_and_map_node(sgg, w);
-                sgg.add_edge(sgg.mapped_idx(parent), sgg.mapped_idx(w), weight);
-                dfs_add_neighbors_to_stack(subgraph, visited, stack, w);
+                if (!sgg.is_mapped(w)) add_and_map_node(sgg, compressed, w);
+                compressed.add_edge(sgg.mapped_idx(parent), sgg.mapped_idx(w), weight);
+                dfs_add_neighbors_to_stack(subgraph, stack, w);
                 visited[w] = true;
             }
         }
 
+        sgg.set_graph(CsrGraph(compressed));
+        sgg.set_components(Components::compute(sgg));
+
         return sgg;
     }
 
 private:
     // Functions used by the builder's DFS search.
+    template <typename SubgraphT>
     static void dfs_add_neighbors_to_stack(
-        const Graph& subgraph,
-        const std::vector<bool>& visited,
+        const SubgraphT& subgraph,
         std::vector<std::tuple<int_t, int_t, real_t>>& stack,
         int_t original_idx)
     {
@@ -66,9 +77,11 @@ private:
         }
     }
 
-    static void add_and_map_node(SingleGenomeGraph& sgg, int_t original_idx) { sgg.map_node(original_idx, INT_T_MAX, sgg.size()); sgg.add_node(); } // Add non-path node.
+    // Add non-path node.
+    static void add_and_map_node(SingleGenomeGraph& sgg, Graph& compressed, int_t original_idx) { sgg.map_node(original_idx, NODE_T_MAX, compressed.size()); compressed.add_node(); }
 
-    static std::pair<int_t, real_t> process_path(SingleGenomeGraph& sgg, const Graph& subgraph, std::vector<bool>& visited, int_t path_start_node, int_t w, real_t weight) {
+    template <typename SubgraphT>
+    static std::pair<int_t, real_t> process_path(SingleGenomeGraph& sgg, const Graph& compressed, const SubgraphT& subgraph, std::vector<bool>& visited, int_t path_start_node, int_t w, real_t weight) {
         // First node given.
         std::vector<int_t> nodes_in_path{w};
         std::vector<real_t> D{weight};
@@ -94,7 +107,7 @@ private:
         }
 
         // Add new path.
-        auto mapped_path_end_node = sgg.is_mapped(w) ? sgg.mapped_idx(w) : sgg.size(); // Can use size() here because w will be added and mapped next.
+        auto mapped_path_end_node = sgg.is_mapped(w) ? sgg.mapped_idx(w) : compressed.size(); // Can use size() here because w will be added and mapped next.
         sgg.add_new_path(sgg.mapped_idx(path_start_node), mapped_path_end_node, std::move(D));
         return std::make_pair(w, weight); // Return updated w and weight.
     }
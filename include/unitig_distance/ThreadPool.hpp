@@ -0,0 +1,145 @@
+/*
+    Process-wide pool of worker threads shared by all parallel stages, so that threads are created once
+    instead of for every block of work. The pool has ProgramOptions::n_threads workers, which can be
+    pinned to CPU cores with -pin [ --pin-threads ]. Work submitted from a worker thread is run inline,
+    so nested parallel calls can't deadlock the pool.
+*/
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "ProgramOptions.hpp"
+#include "types.hpp"
+
+class ThreadPool {
+public:
+    // The pool is started on first use, after the command line arguments have been read.
+    static ThreadPool& instance() {
+        static ThreadPool pool(std::max<int_t>(ProgramOptions::n_threads, 1), ProgramOptions::pin_threads);
+        return pool;
+    }
+
+    ThreadPool(std::size_t n_threads, bool pin_threads) : m_stop(false) {
+        auto cpus = pin_threads ? allowed_cpus() : std::vector<int>();
+        bool pinned = true;
+        for (std::size_t thr = 0; thr < n_threads; ++thr) {
+            m_workers.emplace_back(&ThreadPool::work, this);
+            if (pin_threads) pinned = pin(m_workers.back(), cpus, thr) && pinned;
+        }
+        if (!pinned) std::cerr << "Warning: Failed to pin worker threads to CPU cores." << std::endl;
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_all();
+        for (auto& worker : m_workers) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t size() const { return m_workers.size(); }
+
+    // Submit a task, returns a future for its result.
+    template <typename F>
+    std::future<typename std::result_of<F()>::type> submit(F f) {
+        using result_t = typename std::result_of<F()>::type;
+        auto task = std::make_shared<std::packaged_task<result_t()>>(std::move(f));
+        auto future = task->get_future();
+        if (in_worker()) {
+            (*task)();
+            return future;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.emplace([task]() { (*task)(); });
+        }
+        m_condition.notify_one();
+        return future;
+    }
+
+    // Call f(task_idx) for each task_idx in [0, n_tasks) in the pool and wait for the calls to finish.
+    void run(std::size_t n_tasks, const std::function<void(std::size_t)>& f) {
+        if (n_tasks == 1 || in_worker()) {
+            for (std::size_t task_idx = 0; task_idx < n_tasks; ++task_idx) f(task_idx);
+            return;
+        }
+        std::vector<std::future<void>> futures;
+        for (std::size_t task_idx = 0; task_idx < n_tasks; ++task_idx) futures.push_back(submit([&f, task_idx]() { f(task_idx); }));
+        for (auto& future : futures) future.get();
+    }
+
+private:
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stop;
+
+    static bool& in_worker() {
+        static thread_local bool worker = false;
+        return worker;
+    }
+
+    void work() {
+        in_worker() = true;
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+                if (m_tasks.empty()) return; // Stopped and no tasks left.
+                task = std::move(m_tasks.front());
+                m_tasks.pop();
+            }
+            task();
+        }
+    }
+
+    // CPUs the process is allowed to run on, which may be restricted with taskset or cgroups.
+    static std::vector<int> allowed_cpus() {
+        std::vector<int> cpus;
+#ifdef __linux__
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        if (sched_getaffinity(0, sizeof(cpu_set_t), &mask) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) if (CPU_ISSET(cpu, &mask)) cpus.push_back(cpu);
+        }
+#endif
+        return cpus;
+    }
+
+    // Pin worker thr to one of the allowed CPUs, returns false if pinning failed.
+    static bool pin(std::thread& thread, const std::vector<int>& cpus, std::size_t thr) {
+#ifdef __linux__
+        if (cpus.empty()) return false;
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        CPU_SET(cpus[thr % cpus.size()], &mask);
+        return pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &mask) == 0;
+#else
+        return false;
+#endif
+    }
+
+};
@@ -22,6 +22,8 @@ public:
 
     void add_time_since_mark() { m_stopwatch += time_elapsed(m_mark); }
 
+    void add_stopwatch_time(const Timer& other) { m_stopwatch += other.m_stopwatch; }
+
     std::string get_stopwatch_time() const { return get_time_str(m_stopwatch); }
 
     std::string get_stopwatch_time_since_lap_and_set_lap() { auto time_str = get_time_str(m_stopwatch - m_lap); set_lap(); return time_str; }
@@ -1,26 +1,37 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <iostream>
 #include <string>
 #include <tuple>
 #include <vector>
 
+#include "LineReader.hpp"
 #include "ProgramOptions.hpp"
+#include "ThreadPool.hpp"
 #include "types.hpp"
 
 class Utils {
 public:
-    static std::vector<std::string> get_fields(const std::string& line, char delim = ' ') {
-        std::vector<std::string> fields;
-        std::stringstream ss(line);
-        for (std::string field; std::getline(ss, field, delim); ) fields.push_back(std::move(field));
-        return fields;
-    }
-
     static bool file_is_good(const std::string& filename) {
         return std::ifstream(filename).good();
     }
 
+    // Check that an input file can be opened, and that it can be decompressed if it is compressed.
+    static bool input_file_is_good(const std::string& filename) {
+        if (!file_is_good(filename)) {
+            std::cerr << "Error: Can't open " << filename << std::endl;
+            return false;
+        }
+        if (!LineReader::can_decompress(filename)) {
+            std::cerr << "Error: " << filename << " is compressed, but " << LineReader::decompressor(filename) << " was not found." << std::endl;
+            return false;
+        }
+        return true;
+    }
+
     static std::string neat_number_str(int_t number) {
         std::vector<int_t> parts;
         do parts.push_back(number % 1000);
@@ -34,32 +45,57 @@ public:
 
     static std::string neat_decimal_str(int_t nom, int_t denom) {
         std::string int_str = std::to_string(nom / denom);
-        std::string dec_str = std::to_string(nom * 100 / denom % 100);
+        std::string dec_str = std::to_string(nom % denom * 100 / denom);
         return int_str + "." + std::string(2 - dec_str.size(), '0') + dec_str;
     }
 
-    static real_t fixed_distance(real_t distance, real_t max_distance = REAL_T_MAX) { return distance >= max_distance ? -1.0 : distance; }
+    // Node indices are stored as node_t, which is 32-bit in the compact build. NODE_T_MAX is reserved for unmapped nodes.
+    static bool valid_node(int_t v) { return v >= 0 && v < NODE_T_MAX; }
 
-    static bool is_numeric(const std::string& str) {
-        double x;
-        return (std::stringstream(str) >> x).eof();
+    // Unitig indices, which must leave room for both sides of each unitig as node indices.
+    static bool valid_unitig(int_t v) { return v >= 0 && v < NODE_T_MAX / 2; }
+
+    /*
+        Edge weights are stored as weight_t, which is single precision in the compact build and represents integers
+        exactly only up to 2^24. Warns once if a weight, such as the length of a long compressed path, is rounded.
+    */
+    static void check_weight(real_t weight) {
+        static std::atomic<bool> warned(false);
+        if ((real_t) (weight_t) weight == weight || warned.exchange(true)) return;
+        std::cerr << "Warning: Edge weight " << std::to_string(weight) << " can't be stored exactly in " << 8 * sizeof(weight_t)
+                  << "-bit edge weights and was rounded to " << std::to_string((real_t) (weight_t) weight) << ", distances may be inexact." << std::endl;
     }
 
+    static real_t fixed_distance(real_t distance, real_t max_distance = REAL_T_MAX) { return distance >= max_distance ? -1.0 : distance; }
+
     template <typename T>
     static void clear(T& container) { T().swap(container); }
 
+    // Sort chunks of the vector in parallel, then merge the sorted chunks pairwise in parallel rounds.
+    template <typename T, typename Compare>
+    static void parallel_sort(std::vector<T>& vector, Compare comp, int_t n_threads) {
+        std::size_t sz = vector.size(), n_chunks = std::max<int_t>(1, std::min<int_t>(n_threads, sz / 10000));
+        std::vector<std::size_t> bounds;
+        for (std::size_t i = 0; i <= n_chunks; ++i) bounds.push_back(i * sz / n_chunks);
+        auto it = vector.begin();
+
+        ThreadPool::instance().run(n_chunks, [it, &bounds, &comp](std::size_t i) { std::sort(it + bounds[i], it + bounds[i + 1], comp); });
+
+        for (std::size_t step = 1; step < n_chunks; step *= 2) {
+            std::size_t n_merges = (n_chunks - step + 2 * step - 1) / (2 * step);
+            ThreadPool::instance().run(n_merges, [it, &bounds, &comp, step, n_chunks](std::size_t merge_idx) {
+                std::size_t i = merge_idx * 2 * step;
+                std::inplace_merge(it + bounds[i], it + bounds[i + step], it + bounds[std::min(i + 2 * step, n_chunks)], comp);
+            });
+        }
+    }
+
     static bool sanity_check_input_files() {
         if (ProgramOptions::operating_mode != OperatingMode::OUTLIER_TOOLS) {
-            if (!Utils::file_is_good(ProgramOptions::edges_filename)) {
-                std::cerr << "Error: Can't open " << ProgramOptions::edges_filename << std::endl;
-                return false;
-            }
+            if (!input_file_is_good(ProgramOptions::main_graph_filename())) return false;
 
             if (ProgramOptions::has_operating_mode(OperatingMode::CDBG)) {
-                if (!Utils::file_is_good(ProgramOptions::unitigs_filename)) {
-                    std::cerr << "Error: Can't open " << ProgramOptions::unitigs_filename << std::endl;
-                    return false;
-                }
+                if (ProgramOptions::gfa_filename.empty() && !input_file_is_good(ProgramOptions::unitigs_filename)) return false;
 
                 if (ProgramOptions::has_operating_mode(OperatingMode::SGGS)) {
                     if (!Utils::file_is_good(ProgramOptions::sggs_filename)) {
@@ -68,20 +104,14 @@ public:
                     }
                     std::ifstream ifs(ProgramOptions::sggs_filename);
                     for (std::string path_edges; std::getline(ifs, path_edges); ) {
-                        if (!Utils::file_is_good(path_edges)) {
-                            std::cerr << "Error: Can't open " << path_edges << std::endl;
-                            return false;
-                        }
+                        if (!input_file_is_good(path_edges)) return false;
                     }
                 }
             }
         }
 
         if (!ProgramOptions::queries_filename.empty()) {
-            if (!Utils::file_is_good(ProgramOptions::queries_filename)) {
-                std::cerr << "Error: Can't open " << ProgramOptions::queries_filename << std::endl;
-                return false;
-            }
+            if (!input_file_is_good(ProgramOptions::queries_filename)) return false;
         }
 
         return true;
@@ -97,8 +127,7 @@ public:
          4: v w d s c
          5: v w d f s c
     */
-    static int_t deduce_queries_format(const std::string& line) {
-        auto fields_sz = get_fields(line).size();
+    static int_t deduce_queries_format(std::size_t fields_sz) {
         bool ot_mode = ProgramOptions::operating_mode == OperatingMode::OUTLIER_TOOLS;
         switch (fields_sz) {
             case 2: return 0;
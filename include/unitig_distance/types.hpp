@@ -5,9 +5,25 @@
 
 // Define types used by the program.
 
+// General integers and reals, such as counts, offsets, distances and statistics.
 using int_t = int64_t;
 const int_t INT_T_MAX = std::numeric_limits<int_t>::max();
 
 using real_t = double;
 const real_t REAL_T_MAX = std::numeric_limits<real_t>::max();
 
+// Node indices and edge weights stored in the graphs, indexes, search jobs and queries.
+#ifdef UNITIG_DISTANCE_COMPACT
+
+// Compact configuration (make compact): 32-bit node indices and edge weights halve the memory used by the largest arrays.
+using node_t = int32_t;
+using weight_t = float;
+
+#else
+
+using node_t = int64_t;
+using weight_t = double;
+
+#endif
+
+const node_t NODE_T_MAX = std::numeric_limits<node_t>::max();
@@ -6,14 +6,20 @@ char** ProgramOptions::argv;
 
 std::string ProgramOptions::unitigs_filename = "";
 std::string ProgramOptions::edges_filename = "";
+std::string ProgramOptions::gfa_filename = "";
 std::string ProgramOptions::queries_filename = "";
 std::string ProgramOptions::sggs_filename = "";
+std::string ProgramOptions::ch_index_filename = "";
+std::string ProgramOptions::hub_labels_filename = "";
+std::string ProgramOptions::save_graph_filename = "";
+std::string ProgramOptions::load_graph_filename = "";
 std::string ProgramOptions::out_stem = "out";
 int_t ProgramOptions::k = 0; 
 int_t ProgramOptions::n_queries = INT_T_MAX;
 int_t ProgramOptions::queries_format = -1;
 real_t ProgramOptions::max_distance = REAL_T_MAX;
 int_t ProgramOptions::n_threads = 1; 
+int_t ProgramOptions::n_landmarks = 0;
 int_t ProgramOptions::sgg_count_threshold = 10;
 int_t ProgramOptions::ld_distance = -1;
 int_t ProgramOptions::ld_distance_min = 1000;
@@ -24,7 +30,12 @@ bool ProgramOptions::graphs_one_based = false;
 bool ProgramOptions::queries_one_based = false;
 bool ProgramOptions::output_one_based = false;
 bool ProgramOptions::run_sggs_only = false;
+bool ProgramOptions::build_ch_index = false;
+bool ProgramOptions::build_hub_labels = false;
+bool ProgramOptions::compress_paths = false;
+bool ProgramOptions::reorder_nodes = false;
 bool ProgramOptions::output_outliers = false;
+bool ProgramOptions::pin_threads = false;
 bool ProgramOptions::verbose = false;
 
 bool ProgramOptions::valid_state = true;
@@ -1,19 +1,30 @@
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
 #include <iostream>
+#include <mutex>
 #include <string>
-#include <thread>
+#include <utility>
 #include <vector>
 
+#include "ColoredEdgeIndex.hpp"
 #include "DistanceVector.hpp"
-#include "Graph.hpp"
+#include "CsrGraph.hpp"
 #include "PrintUtils.hpp"
 #include "SearchJobs.hpp"
+#include "SearchWorkspace.hpp"
 #include "SingleGenomeGraph.hpp"
 #include "SingleGenomeGraphBuilder.hpp"
 #include "SingleGenomeGraphDistances.hpp"
+#include "ThreadPool.hpp"
 #include "Timer.hpp"
 #include "types.hpp"
+#include "Utils.hpp"
 
-DistanceVector calculate_sgg_distances(const Graph& graph, const SearchJobs& search_jobs, Timer& timer) {
+// Single genome graphs per thread that can be built but not yet solved.
+static constexpr std::size_t SGG_QUEUE_DEPTH = 2;
+
+DistanceVector calculate_sgg_distances(const CsrGraph& graph, const SearchJobs& search_jobs, Timer& timer) {
     DistanceVector sgg_distances(search_jobs.n_queries(), 0.0, 0);
 
     sgg_distances.set_mean_distances();
@@ -22,108 +33,133 @@ DistanceVector calculate_sgg_distances(const Graph& graph, const SearchJobs& sea
     std::vector<std::string> path_edge_files;
     std::ifstream ifs(ProgramOptions::sggs_filename);
     for (std::string path_edges; std::getline(ifs, path_edges); ) path_edge_files.emplace_back(path_edges);
-    std::size_t n_sggs = path_edge_files.size(), batch_size = ProgramOptions::n_threads;
+    std::size_t n_sggs = path_edge_files.size(), n_threads = std::max<int_t>(ProgramOptions::n_threads, 1);
 
     if (n_sggs == 0) {
         std::cerr << "Error: Couldn't read single genome graph files." << std::endl;
         return DistanceVector();
     }
 
+    // The edges files are only read when the colored edge index is built, single genome graphs are then constructed from the index.
+    auto index = ColoredEdgeIndex::load_or_build(graph, path_edge_files, ProgramOptions::colors_filename(), n_threads);
+    if (index.n_colors() == 0) {
+        std::cerr << "Error: Failed to construct colored edge index of the single genome graphs." << std::endl;
+        return DistanceVector();
+    }
+    if (ProgramOptions::verbose) PrintUtils::print_tbss_tsmasm(timer, "Prepared colored edge index with", index.n_runs(), "color runs for", n_sggs, "single genome graphs");
+
+    /*
+        Every worker both builds single genome graphs and solves them, so that constructing the next
+        graphs overlaps with searching the previous ones. Graphs are built in file order by whichever worker
+        is free, and worker thr solves graphs thr, thr + n_threads, ... in order, preferring solving to
+        building. At most SGG_QUEUE_DEPTH graphs per thread are built but not yet solved, which bounds the
+        memory use. Each worker adds the distances to its own dense accumulator indexed by query with Welford's
+        update. At the end, the accumulators are merged in parallel over queries with Chan et al.'s update, in
+        thread order for each query. The results therefore don't depend on scheduling. A different number of
+        threads splits the graphs differently between the accumulators, which can change the last bits of
+        the means and M2.
+    */
+    std::size_t max_pending = SGG_QUEUE_DEPTH * n_threads;
+    std::vector<SingleGenomeGraph> built_sggs(n_sggs);
+    std::vector<bool> built(n_sggs, false);
+    std::size_t next_sgg = 0, n_pending = 0, n_solved = 0;
+    bool failed = false;
+    std::mutex queue_mutex;
+    std::condition_variable queue_condition;
+
+    // Search workspaces are reused across all single genome graphs.
+    std::vector<SearchWorkspace> workspaces(n_threads);
+    std::vector<std::vector<Distance>> thread_distances(n_threads);
+
     // Printing variables for verbose mode.
-    Timer t_sgg, t_sgg_distances, t_deconstruct;
-    int_t print_interval = (n_sggs + 4) / 5, print_i = 1, n_nodes = 0, n_edges = 0;
-    if (print_interval % batch_size) print_interval += batch_size - (print_interval % batch_size); // Round up.
-    bool print_now = false;
+    std::vector<Timer> t_sgg(n_threads), t_sgg_distances(n_threads);
+    std::size_t print_interval = (n_sggs + 4) / 5;
+    int_t n_nodes = 0, n_edges = 0;
 
     if (ProgramOptions::verbose) PrintUtils::print_tbssasm(timer, "Calculating distances in the single genome graphs");
 
-    for (std::size_t i = 0; i < n_sggs; i += batch_size) {
-        if (ProgramOptions::verbose) {
-            t_deconstruct.add_time_since_mark();
-            if (print_now) {
-                auto stslasl = t_deconstruct.get_stopwatch_time_since_lap_and_set_lap();
-                PrintUtils::print_tbss(timer, "Deconstructing single genome graphs", print_i, "-", i, "/", n_sggs, "took", stslasl);
-                print_i = i + 1;
-            }
-            t_sgg.set_mark();
-        }
-
-        if (ProgramOptions::verbose) print_now = (i + batch_size) % print_interval == 0 || (i + batch_size) >= n_sggs;
-
-        auto batch = std::min(i + batch_size, n_sggs) - i;
-
-        // Construct a batch of single genome graphs.
-        std::vector<SingleGenomeGraph> sg_graphs(batch);
-        auto construct_sgg = [&graph, &sg_graphs](int_t thr, const std::string& path_edges) {
-            sg_graphs[thr] = SingleGenomeGraphBuilder::build_sgg(graph, path_edges);
-        };
-
-        std::vector<std::thread> threads;
-        for (std::size_t thr = 0; thr < batch; ++thr) threads.emplace_back(construct_sgg, thr, path_edge_files[i + thr]);
-        for (auto& thr : threads) thr.join();
-
-        for (const auto& sg_graph : sg_graphs) {
-            if (sg_graph.size() == 0) {
-                std::cerr << "Error: Failed to construct single genome graph." << std::endl;
-                return DistanceVector();
-            }
-        }
-
-        if (ProgramOptions::verbose) {
-            t_sgg.add_time_since_mark();
-            if (print_now) {
-                auto stslasl = t_sgg.get_stopwatch_time_since_lap_and_set_lap();
-                PrintUtils::print_tbss(timer, "Constructing single genome graphs", print_i, "-", i + batch, "/", n_sggs, "took", stslasl);
-            }
-            // Update n_nodes and n_edges.
-            for (const auto& sg_graph : sg_graphs) {
-                n_nodes += sg_graph.size();
-                for (const auto& adj : sg_graph) n_edges += adj.size();
-            }
-            t_sgg_distances.set_mark();
-        }
-
-        // Calculate distances in the single genome graphs.
-        for (const auto& sg_graph : sg_graphs) {
-            auto sgg_batch_distances = SingleGenomeGraphDistances(sg_graph).solve(search_jobs);
-            // Combine results across threads.
-            for (const auto& distances : sgg_batch_distances) {
-                for (const auto& result : distances) {
-                    int_t original_idx;
-                    Distance distance;
-                    std::tie(original_idx, distance) = result;
-                    sgg_distances[original_idx] += distance;
+    auto work = [&graph, &search_jobs, &timer, &index, n_sggs, n_threads, max_pending, &built_sggs, &built, &next_sgg, &n_pending, &n_solved, &failed,
+                 &queue_mutex, &queue_condition, &workspaces, &thread_distances, &t_sgg, &t_sgg_distances, print_interval, &n_nodes, &n_edges](std::size_t thr) {
+        auto& distances = thread_distances[thr];
+        distances.resize(search_jobs.n_queries());
+        std::size_t own_sgg = thr; // Next graph this worker solves.
+
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        while (true) {
+            auto can_solve = [&built, own_sgg, n_sggs]() { return own_sgg < n_sggs && built[own_sgg]; };
+            auto can_build = [&next_sgg, &n_pending, n_sggs, max_pending]() { return next_sgg < n_sggs && n_pending < max_pending; };
+            auto done = [&next_sgg, own_sgg, n_sggs]() { return own_sgg >= n_sggs && next_sgg == n_sggs; };
+            queue_condition.wait(lock, [&failed, &can_solve, &can_build, &done]() { return failed || can_solve() || can_build() || done(); });
+            if (failed || (!can_solve() && !can_build())) return;
+
+            if (can_solve()) {
+                auto sg_graph = std::move(built_sggs[own_sgg]);
+                own_sgg += n_threads;
+                lock.unlock();
+
+                // Calculate distances in the single genome graph.
+                t_sgg_distances[thr].set_mark();
+                SingleGenomeGraphDistances(sg_graph).solve(search_jobs, workspaces[thr], distances);
+                Utils::clear(sg_graph);
+                t_sgg_distances[thr].add_time_since_mark();
+
+                lock.lock();
+                --n_pending;
+                ++n_solved;
+                if (ProgramOptions::verbose && (n_solved % print_interval == 0 || n_solved == n_sggs)) {
+                    PrintUtils::print_tbss(timer, "Calculated distances in", n_solved, "/", n_sggs, "single genome graphs");
+                }
+            } else {
+                auto sgg_idx = next_sgg++;
+                ++n_pending;
+                lock.unlock();
+
+                // Construct the next single genome graph.
+                t_sgg[thr].set_mark();
+                auto sg_graph = SingleGenomeGraphBuilder::build_sgg(graph, index, sgg_idx);
+                t_sgg[thr].add_time_since_mark();
+
+                lock.lock();
+                if (sg_graph.size() == 0) {
+                    if (!failed) std::cerr << "Error: Failed to construct single genome graph." << std::endl;
+                    failed = true;
+                } else {
+                    n_nodes += sg_graph.size();
+                    n_edges += sg_graph.n_edges();
+                    built_sggs[sgg_idx] = std::move(sg_graph);
+                    built[sgg_idx] = true;
                 }
             }
+            queue_condition.notify_all();
         }
-
-        if (ProgramOptions::verbose) {
-            t_sgg_distances.add_time_since_mark();
-            if (print_now) {
-                auto stslasl = t_sgg_distances.get_stopwatch_time_since_lap_and_set_lap();
-                PrintUtils::print_tbss(timer, "Calculating distances in the single genome graphs", print_i, "-", i + batch, "/", n_sggs, "took", stslasl);
-            }
-            t_deconstruct.set_mark();
+    };
+    ThreadPool::instance().run(n_threads, work);
+
+    if (failed) return DistanceVector();
+
+    // Merge the accumulators in parallel over ranges of queries, disconnected queries get max distance.
+    std::size_t n_queries = sgg_distances.size();
+    ThreadPool::instance().run(n_threads, [&sgg_distances, &thread_distances, n_queries, n_threads](std::size_t thr) {
+        for (std::size_t idx = n_queries * thr / n_threads; idx < n_queries * (thr + 1) / n_threads; ++idx) {
+            Distance distance;
+            for (const auto& distances : thread_distances) distance = distance.merge(distances[idx]);
+            sgg_distances[idx] = distance.count() > 0 ? distance : Distance(REAL_T_MAX, 0);
         }
-    }
-
-    if (ProgramOptions::verbose) {
-        t_deconstruct.add_time_since_mark();
-        auto stslasl = t_deconstruct.get_stopwatch_time_since_lap_and_set_lap();
-        PrintUtils::print_tbss(timer, "Deconstructing single genome graphs and distances", print_i, "-", n_sggs, "/", n_sggs, "took", stslasl);
-    }
-
-    // Set distance correctly for disconnected queries.
-    for (auto& distance : sgg_distances) if (distance.count() == 0) distance = Distance(REAL_T_MAX, 0);
+    });
+    Utils::clear(thread_distances);
 
     if (ProgramOptions::verbose) {
         n_nodes /= n_sggs;
-        n_edges /= 2 * n_sggs;
-        PrintUtils::print_tbss(timer, "Constructing", n_sggs, "single genome graphs took", t_sgg.get_stopwatch_time());
+        n_edges /= n_sggs;
+        for (std::size_t thr = 1; thr < n_threads; ++thr) {
+            t_sgg[0].add_stopwatch_time(t_sgg[thr]);
+            t_sgg_distances[0].add_stopwatch_time(t_sgg_distances[thr]);
+        }
+        PrintUtils::print_tbss(timer, "Constructing", n_sggs, "single genome graphs took", t_sgg[0].get_stopwatch_time(), "summed over threads");
         PrintUtils::print_tbss(timer, "The compressed single genome graphs have on average", Utils::neat_number_str(n_nodes), "connected nodes and", 
                                Utils::neat_number_str(n_edges), "edges");
-        PrintUtils::print_tbss(timer, "Calculating distances in the", n_sggs, "single genome graphs took", t_sgg_distances.get_stopwatch_time());
-        PrintUtils::print_tbssasm(timer, "Deconstructing", n_sggs, "single genome graphs took", t_deconstruct.get_stopwatch_time());
+        PrintUtils::print_tbss(timer, "Calculating distances in the", n_sggs, "single genome graphs took", t_sgg_distances[0].get_stopwatch_time(), "summed over threads");
+        PrintUtils::print_tbss_tsmasm(timer, "Calculated distances in the", n_sggs, "single genome graphs");
     }
 
     return sgg_distances;
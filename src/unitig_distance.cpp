@@ -2,14 +2,22 @@
 #include <string>
 
 #include "QueriesReader.hpp"
+#include "Components.hpp"
+#include "ContractionHierarchy.hpp"
+#include "CsrGraph.hpp"
+#include "Graph.hpp"
 #include "GraphBuilder.hpp"
 #include "GraphDistances.hpp"
+#include "HubLabels.hpp"
+#include "Landmarks.hpp"
 #include "OperatingMode.hpp"
 #include "OutlierTools.hpp"
 #include "PrintUtils.hpp"
 #include "ProgramOptions.hpp"
 #include "ResultsWriter.hpp"
 #include "SearchJobs.hpp"
+#include "SingleGenomeGraph.hpp"
+#include "SingleGenomeGraphBuilder.hpp"
 #include "SingleGenomeGraphDistances.hpp"
 #include "Timer.hpp"
 #include "types.hpp"
@@ -17,6 +25,68 @@
 
 static int fail_with_error(const std::string& error) { std::cerr << error << std::endl; return 1; }
 
+/*
+    Construct the main graph according to operating mode and freeze it for searching, or load it from a saved binary file.
+    The mutable graph is also returned in built_graph if keep_built_graph is set.
+*/
+static bool construct_main_graph(CsrGraph& graph, Graph& built_graph, bool keep_built_graph, Timer& timer) {
+    if (!ProgramOptions::load_graph_filename.empty()) {
+        if (!graph.load(ProgramOptions::load_graph_filename, GraphBuilder::input_fingerprint())) {
+            std::cerr << "Error: Failed to load main graph from " << ProgramOptions::load_graph_filename << " (was it saved from these graph files?)" << std::endl;
+            return false;
+        }
+        if (keep_built_graph) built_graph = graph.to_graph();
+    } else {
+        built_graph = GraphBuilder::build_correct_graph();
+        graph = CsrGraph(built_graph);
+        if (!keep_built_graph) Utils::clear(built_graph);
+    }
+    if (graph.size() == 0) {
+        std::cerr << "Error: Failed to construct main graph." << std::endl;
+        return false;
+    }
+    if (ProgramOptions::verbose) {
+        PrintUtils::print_tbss_tsmasm_noendl(timer, ProgramOptions::load_graph_filename.empty() ? "Constructed main graph" : "Loaded main graph");
+        graph.print_details();
+    }
+    if (!ProgramOptions::save_graph_filename.empty()) {
+        if (!graph.save(ProgramOptions::save_graph_filename, GraphBuilder::input_fingerprint())) {
+            std::cerr << "Error: Failed to save main graph to " << ProgramOptions::save_graph_filename << std::endl;
+            return false;
+        }
+        if (ProgramOptions::verbose) PrintUtils::print_tbss_tsmasm(timer, "Saved main graph to", ProgramOptions::save_graph_filename);
+    }
+    return true;
+}
+
+// Preprocessing mode: build the requested search indexes for the main graph and write them to file.
+static int build_indexes(Timer& timer) {
+    CsrGraph graph;
+    Graph built_graph;
+    if (!construct_main_graph(graph, built_graph, false, timer)) return 1;
+    if (ProgramOptions::reorder_nodes) {
+        graph.reorder_nodes();
+        if (ProgramOptions::verbose) PrintUtils::print_tbss_tsmasm(timer, "Reordered main graph nodes");
+    }
+    if (ProgramOptions::build_ch_index) {
+        const auto ch = ContractionHierarchy::build(graph, ProgramOptions::n_threads);
+        if (!ch.save(graph, ProgramOptions::ch_index_filename)) return fail_with_error("Error: Failed to write contraction hierarchy index to " + ProgramOptions::ch_index_filename);
+        if (ProgramOptions::verbose) {
+            PrintUtils::print_tbss_tsmasm(timer, "Built contraction hierarchy with", Utils::neat_number_str(ch.n_upward_edges()), "upward edges and wrote it to",
+                                          ProgramOptions::ch_index_filename);
+        }
+    }
+    if (ProgramOptions::build_hub_labels) {
+        const auto hub_labels = HubLabels::build(graph);
+        if (!hub_labels.save(graph, ProgramOptions::hub_labels_filename)) return fail_with_error("Error: Failed to write hub labels to " + ProgramOptions::hub_labels_filename);
+        if (ProgramOptions::verbose) {
+            PrintUtils::print_tbss_tsmasm(timer, "Built hub labels with", Utils::neat_number_str(hub_labels.n_label_entries()), "entries and wrote them to",
+                                          ProgramOptions::hub_labels_filename);
+        }
+    }
+    return 0;
+}
+
 int main(int argc, char** argv) {
     Timer timer;
 
@@ -26,6 +96,9 @@ int main(int argc, char** argv) {
     if (!ProgramOptions::valid_state || !Utils::sanity_check_input_files()) return 1;
     if (ProgramOptions::verbose) ProgramOptions::print_run_details();
 
+    // Preprocessing only.
+    if (ProgramOptions::build_indexes_only()) return build_indexes(timer);
+
     // Read queries.
     const auto queries = QueriesReader::read_queries(timer);
     if (queries.size() == 0) return fail_with_error("Error: Failed to read queries.");
@@ -42,16 +115,25 @@ int main(int argc, char** argv) {
     }
 
     // Compute search jobs.
-    const SearchJobs search_jobs(queries);
+    const SearchJobs search_jobs(queries, ProgramOptions::n_threads);
     if (ProgramOptions::verbose) PrintUtils::print_tbss_tsmasm(timer, "Prepared", Utils::neat_number_str(search_jobs.size()), "search jobs");
 
-    // Construct the graph according to operating mode.
-    const auto graph = GraphBuilder::build_correct_graph();
-    if (graph.size() == 0) return fail_with_error("Error: Failed to construct main graph.");
-    if (ProgramOptions::verbose) {
-        PrintUtils::print_tbss_tsmasm_noendl(timer, "Constructed main graph");
-        graph.print_details();
+    // Construct the main graph, keeping the mutable graph for path compression.
+    bool compress_paths = ProgramOptions::compress_paths && !ProgramOptions::run_sggs_only;
+    CsrGraph graph;
+    Graph built_graph;
+    if (!construct_main_graph(graph, built_graph, compress_paths, timer)) return 1;
+
+    // Compress the paths of the main graph for searching.
+    SingleGenomeGraph compressed_graph;
+    if (compress_paths) {
+        compressed_graph = SingleGenomeGraphBuilder::compress_paths(built_graph);
+        if (ProgramOptions::verbose) {
+            PrintUtils::print_tbss_tsmasm_noendl(timer, "Compressed", Utils::neat_number_str(compressed_graph.n_paths()), "paths in the main graph");
+            compressed_graph.print_details();
+        }
     }
+    Utils::clear(built_graph);
 
     // Calculate distances in the single genome graphs if the single genome graph files were provided.
     if (ProgramOptions::has_operating_mode(OperatingMode::SGGS)) {
@@ -74,8 +156,53 @@ int main(int argc, char** argv) {
     if (!ProgramOptions::run_sggs_only) {
         if (ProgramOptions::verbose) PrintUtils::print_tbssasm(timer, "Calculating distances in the main graph");
 
+        // Single genome graphs are built from the original node order, so the main graph is reordered only now.
+        if (ProgramOptions::reorder_nodes) {
+            graph.reorder_nodes();
+            if (ProgramOptions::verbose) PrintUtils::print_tbss_tsmasm(timer, "Reordered main graph nodes");
+        }
+
+        GraphDistances graph_distances_solver(graph, timer);
+        if (ProgramOptions::compress_paths) graph_distances_solver.use_compressed_graph(compressed_graph);
+
+        // Label connected components to skip searches between them (the compressed graph is searched without them).
+        Components components;
+        if (!ProgramOptions::compress_paths) {
+            components = Components::compute(graph, ProgramOptions::n_threads);
+            graph_distances_solver.use_components(components);
+            if (ProgramOptions::verbose) PrintUtils::print_tbss_tsmasm(timer, "Found", Utils::neat_number_str(components.n_components()), "connected components");
+        }
+
+        // Load or compute landmarks for goal-directed searches.
+        Landmarks landmarks;
+        if (ProgramOptions::n_landmarks > 0) {
+            landmarks = Landmarks::load_or_compute(graph, ProgramOptions::n_landmarks, ProgramOptions::landmarks_filename(), ProgramOptions::n_threads);
+            graph_distances_solver.use_landmarks(landmarks);
+            if (ProgramOptions::verbose) PrintUtils::print_tbss_tsmasm(timer, "Prepared", landmarks.size(), "landmarks");
+        }
+
+        // Load the contraction hierarchy index.
+        ContractionHierarchy ch;
+        if (!ProgramOptions::ch_index_filename.empty()) {
+            if (!ch.load(graph, ProgramOptions::ch_index_filename)) {
+                return fail_with_error("Error: Failed to load contraction hierarchy index " + ProgramOptions::ch_index_filename + " (was it built from this graph?)");
+            }
+            graph_distances_solver.use_contraction_hierarchy(ch);
+            if (ProgramOptions::verbose) PrintUtils::print_tbss_tsmasm(timer, "Loaded contraction hierarchy index");
+        }
+
+        // Load the hub labels.
+        HubLabels hub_labels;
+        if (!ProgramOptions::hub_labels_filename.empty()) {
+            if (!hub_labels.load(graph, ProgramOptions::hub_labels_filename)) {
+                return fail_with_error("Error: Failed to load hub labels " + ProgramOptions::hub_labels_filename + " (were they built from this graph?)");
+            }
+            graph_distances_solver.use_hub_labels(hub_labels);
+            if (ProgramOptions::verbose) PrintUtils::print_tbss_tsmasm(timer, "Loaded hub labels");
+        }
+
         // Calculate distances.
-        const auto graph_distances = GraphDistances(graph, timer).solve(search_jobs);
+        const auto graph_distances = graph_distances_solver.solve(search_jobs);
         timer.set_mark();
 
         ResultsWriter::output_results(ProgramOptions::out_filename(), queries, graph_distances);